@@ -0,0 +1,82 @@
+#include "AssetLoader.h"
+
+#include <Base/Trace.hpp>
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+AssetLoader::AssetLoader(QString path, const GltfAsset::LoadMode mode, const bool useCache,
+						 const SceneCache::VertexFormat format)
+	: path_{std::move(path)}
+	, mode_{mode}
+	, useCache_{useCache}
+	, format_{format}
+{
+	thread_ = std::thread([this] { run(); });
+}
+
+AssetLoader::~AssetLoader()
+{
+	wait();
+}
+
+void AssetLoader::wait()
+{
+	if (thread_.joinable())
+	{
+		thread_.join();
+	}
+}
+
+auto AssetLoader::take(QString & error) -> std::unique_ptr<GltfAsset>
+{
+	wait();
+
+	error = error_;
+	return std::move(asset_);
+}
+
+auto AssetLoader::takeCache() -> std::unique_ptr<SceneCache>
+{
+	wait();
+
+	return std::move(cache_);
+}
+
+void AssetLoader::run()
+{
+	fgl::Trace::setThreadName("asset loader");
+	FGL_TRACE_SCOPE("AssetLoader::run");
+
+	QElapsedTimer timer;
+	timer.start();
+
+	const auto hash = useCache_ ? SceneCache::hashFile(path_) : std::nullopt;
+	const auto cachePath = hash ? SceneCache::pathFor(*hash, format_) : QString();
+	if (hash)
+	{
+		cache_ = SceneCache::open(cachePath, *hash);
+	}
+
+	if (!cache_)
+	{
+		asset_ = GltfAsset::load(path_, mode_, error_);
+	}
+	loadTime_ = timer.elapsed();
+
+	// The next start skips parsing, this one already draws the processed meshes.
+	if (asset_ && hash)
+	{
+		QString error;
+		if (!SceneCache::write(*asset_, *hash, format_, cachePath, error))
+		{
+			qInfo() << "Scene cache not written:" << error;
+		}
+		else if ((cache_ = SceneCache::open(cachePath, *hash)))
+		{
+			asset_.reset();
+		}
+	}
+
+	finished_.store(true, std::memory_order_release);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GltfAsset.h"
+#include "SceneCache.h"
+
+#include <QString>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Parses and decodes a GltfAsset on a worker thread. The render thread polls finished() once
+// per frame and takes the asset when it is, GPU uploads stay on the render thread.
+// With `useCache` an up-to-date scene cache in `format` is opened instead, a missing one is written
+// after parsing and then used right away.
+class AssetLoader final
+{
+public:
+	AssetLoader(QString path, GltfAsset::LoadMode mode, bool useCache,
+				SceneCache::VertexFormat format = SceneCache::VertexFormat::Float);
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader &) = delete;
+	AssetLoader(AssetLoader &&) = delete;
+
+	AssetLoader & operator=(const AssetLoader &) = delete;
+	AssetLoader & operator=(AssetLoader &&) = delete;
+
+	[[nodiscard]] bool finished() const noexcept { return finished_.load(std::memory_order_acquire); }
+	// Blocks until finished().
+	void wait();
+
+	// Require finished(). Null asset on failure, with the reason in `error`.
+	[[nodiscard]] std::unique_ptr<GltfAsset> take(QString & error);
+	// Require finished(). Null unless the scene came from the cache, there is no asset then.
+	[[nodiscard]] std::unique_ptr<SceneCache> takeCache();
+	[[nodiscard]] qint64 loadTime() const noexcept { return loadTime_; }
+
+private:
+	void run();
+
+private:
+	QString path_;
+	GltfAsset::LoadMode mode_;
+	bool useCache_;
+	SceneCache::VertexFormat format_;
+
+	// Written by the worker before finished_ is set.
+	std::unique_ptr<GltfAsset> asset_;
+	std::unique_ptr<SceneCache> cache_;
+	QString error_;
+	qint64 loadTime_ = 0;
+
+	std::atomic<bool> finished_{false};
+	std::thread thread_;
+};
@@ -0,0 +1,182 @@
+#include "GltfAnimation.h"
+
+#include <Base/Trace.hpp>
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+void GltfAnimation::create(const GltfAsset & asset)
+{
+	FGL_TRACE_SCOPE("GltfAnimation::create");
+
+	clear();
+
+	const auto & model = asset.model();
+	size_t skipped = 0;
+	// Weights are kept per mesh, instances of one share whatever the last channel wrote.
+	std::vector<size_t> meshNodes(model.meshes.size());
+	for (const auto & node: model.nodes)
+	{
+		if (node.mesh >= 0 && static_cast<size_t>(node.mesh) < meshNodes.size())
+		{
+			++meshNodes[static_cast<size_t>(node.mesh)];
+		}
+	}
+	std::vector<bool> sharedWeights(model.meshes.size());
+	clips_.resize(model.animations.size());
+	for (size_t i = 0; i < model.animations.size(); ++i)
+	{
+		const auto & animation = model.animations[i];
+		auto & clip = clips_[i];
+		clip.name = animation.name.empty() ? "animation " + std::to_string(i) : animation.name;
+		for (const auto & source: animation.channels)
+		{
+			const auto & path = source.target_path;
+			const auto node = source.target_node;
+			if (node < 0 || static_cast<size_t>(node) >= model.nodes.size() || source.sampler < 0
+				|| static_cast<size_t>(source.sampler) >= animation.samplers.size())
+			{
+				++skipped;
+				continue;
+			}
+
+			Channel channel;
+			channel.node = static_cast<size_t>(node);
+			uint32_t components = 0;
+			if (path == "translation")
+			{
+				channel.path = Path::Translation;
+				components = 3;
+			}
+			else if (path == "rotation")
+			{
+				channel.path = Path::Rotation;
+				components = 4;
+			}
+			else if (path == "scale")
+			{
+				channel.path = Path::Scale;
+				components = 3;
+			}
+			else if (path == "weights" && model.nodes[channel.node].mesh >= 0
+					 && static_cast<size_t>(model.nodes[channel.node].mesh) < model.meshes.size())
+			{
+				channel.path = Path::Weights;
+				channel.mesh = static_cast<size_t>(model.nodes[channel.node].mesh);
+				sharedWeights[channel.mesh] = sharedWeights[channel.mesh] || meshNodes[channel.mesh] > 1;
+			}
+			else
+			{
+				++skipped;
+				continue;
+			}
+
+			const auto & sampler = animation.samplers[static_cast<size_t>(source.sampler)];
+			fgl::AnimationSampler::Curve curve;
+			curve.interpolation = sampler.interpolation == "STEP"
+				? fgl::Interpolation::Step
+				: sampler.interpolation == "CUBICSPLINE" ? fgl::Interpolation::CubicSpline : fgl::Interpolation::Linear;
+			curve.rotation = channel.path == Path::Rotation;
+
+			const auto times = decode(asset, sampler.input);
+			const auto values = decode(asset, sampler.output);
+			// Weights have one scalar per morph target and key.
+			const auto keyValues = times.size() * (curve.interpolation == fgl::Interpolation::CubicSpline ? 3 : 1);
+			if (channel.path == Path::Weights && keyValues > 0)
+			{
+				components = static_cast<uint32_t>(values.size() / keyValues);
+			}
+			curve.times = times;
+			curve.values = values;
+			curve.components = components;
+
+			const auto index = clip.sampler.add(curve);
+			if (!index)
+			{
+				++skipped;
+				continue;
+			}
+			channel.curve = *index;
+			clip.channels.push_back(channel);
+		}
+	}
+
+	select(0);
+	if (skipped > 0)
+	{
+		qWarning() << "Skipped" << skipped << "malformed animation channels";
+	}
+	const auto shared = std::count(sharedWeights.begin(), sharedWeights.end(), true);
+	if (shared > 0)
+	{
+		qWarning() << shared << "meshes with animated weights are drawn by several nodes, which all play the same weights";
+	}
+}
+
+void GltfAnimation::clear()
+{
+	clips_.clear();
+	selected_ = 0;
+	values_.clear();
+}
+
+bool GltfAnimation::select(const size_t clip)
+{
+	if (clip >= clips_.size())
+	{
+		return false;
+	}
+	selected_ = clip;
+	values_.assign(clips_[clip].sampler.outputSize(), 0.0f);
+	return true;
+}
+
+void GltfAnimation::apply(const float time, GltfScene & scene, fgl::JobSystem & jobs)
+{
+	FGL_TRACE_SCOPE("GltfAnimation::apply");
+
+	if (empty())
+	{
+		return;
+	}
+
+	auto & clip = clips_[selected_];
+	const auto duration = clip.sampler.duration();
+	clip.sampler.evaluate(duration > 0.0f ? std::fmod(time, duration) : 0.0f, values_, &jobs);
+
+	// Setting transforms marks the scene graph, which is not thread-safe.
+	for (const auto & channel: clip.channels)
+	{
+		const auto * value = values_.data() + clip.sampler.outputOffset(channel.curve);
+		switch (channel.path)
+		{
+			case Path::Translation:
+				scene.setNodeTranslation(channel.node, std::span<const float, 3>(value, 3));
+				break;
+			case Path::Rotation:
+				scene.setNodeRotation(channel.node, std::span<const float, 4>(value, 4));
+				break;
+			case Path::Scale:
+				scene.setNodeScale(channel.node, std::span<const float, 3>(value, 3));
+				break;
+			case Path::Weights:
+				if (channel.mesh < scene.meshCount())
+				{
+					scene.setMorphWeights(channel.mesh, std::span(value, clip.sampler.components(channel.curve)));
+				}
+				break;
+		}
+	}
+}
+
+std::vector<float> GltfAnimation::decode(const GltfAsset & asset, const int accessor) const
+{
+	// Keys may be normalized integers, the blender converts them like morph targets.
+	const auto stream = asset.attribute(accessor);
+	std::vector<float> values(stream.data ? stream.count * stream.components : 0);
+	blender_.blend(stream, {}, {}, values);
+	return values;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "GltfAsset.h"
+#include "GltfScene.h"
+
+#include <Base/AnimationSampler.hpp>
+#include <Base/MorphBlender.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Keyframe animations of a glTF asset, one clip per animation with every channel that targets a node's
+// translation, rotation, scale or morph weights. Clips usually animate the same nodes, so only the
+// selected one plays, looped over its own duration. Weight channels target nodes but the scene keeps
+// weights per mesh, so nodes sharing a mesh show the weights last written to it.
+class GltfAnimation final
+{
+public:
+	// Copies the keys, the asset is not referenced afterwards. Selects the first clip.
+	void create(const GltfAsset & asset);
+	void clear();
+
+	[[nodiscard]] size_t clipCount() const noexcept { return clips_.size(); }
+	[[nodiscard]] const std::string & clipName(size_t clip) const noexcept { return clips_[clip].name; }
+	// False if there is no such clip, the selection stays as it was.
+	bool select(size_t clip);
+	[[nodiscard]] size_t selected() const noexcept { return selected_; }
+
+	// Of the selected clip.
+	[[nodiscard]] bool empty() const noexcept { return channelCount() == 0; }
+	[[nodiscard]] size_t channelCount() const noexcept { return clips_.empty() ? 0 : clips_[selected_].channels.size(); }
+	[[nodiscard]] float duration() const noexcept { return clips_.empty() ? 0.0f : clips_[selected_].sampler.duration(); }
+	[[nodiscard]] const fgl::AnimationSampler & sampler() const noexcept { return clips_[selected_].sampler; }
+
+	// Evaluates every channel of the selected clip at `time` seconds, curves split across `jobs`, and hands
+	// the results to the scene, which must have been created from the same asset.
+	void apply(float time, GltfScene & scene, fgl::JobSystem & jobs);
+
+private:
+	enum class Path
+	{
+		Translation,
+		Rotation,
+		Scale,
+		Weights,
+	};
+
+	struct Channel {
+		size_t curve = 0;
+		size_t node = 0;
+		Path path = Path::Translation;
+		// Mesh of the node for morph weights.
+		size_t mesh = 0;
+	};
+
+	struct Clip {
+		std::string name;
+		fgl::AnimationSampler sampler;
+		std::vector<Channel> channels;
+	};
+
+	[[nodiscard]] std::vector<float> decode(const GltfAsset & asset, int accessor) const;
+
+private:
+	fgl::MorphBlender blender_;
+	std::vector<Clip> clips_;
+	size_t selected_ = 0;
+	// Output of the selected clip's sampler.
+	std::vector<float> values_;
+};
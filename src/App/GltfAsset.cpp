@@ -0,0 +1,619 @@
+#include "GltfAsset.h"
+
+#include <Base/Trace.hpp>
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QQuaternion>
+
+#include <tinygltf/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace
+{
+
+constexpr std::uint32_t g_glb_magic = 0x46546C67;// "glTF"
+constexpr std::uint32_t g_glb_json_chunk = 0x4E4F534A;
+constexpr std::uint32_t g_glb_bin_chunk = 0x004E4942;
+constexpr size_t g_glb_header_size = 12;
+constexpr size_t g_glb_chunk_header_size = 8;
+
+// Images stored in the BIN chunk are redirected through the FS callbacks with this scheme.
+constexpr std::string_view g_view_scheme = "glb-view:";
+
+// tinygltf has no way to leave a GLB buffer unloaded, so the BIN buffer is replaced
+// with a tiny embedded one and served from the mapping afterwards.
+constexpr std::string_view g_placeholder_uri = "data:application/octet-stream;base64,AAAAAA==";
+constexpr size_t g_placeholder_size = 4;
+
+struct GlbChunks {
+	std::span<const std::byte> json;
+	std::span<const std::byte> bin;
+};
+
+std::uint32_t readU32(const std::span<const std::byte> bytes, const size_t offset)
+{
+	std::uint32_t value = 0;
+	std::memcpy(&value, bytes.data() + offset, sizeof(value));
+	return value;
+}
+
+bool isGlb(const std::span<const std::byte> bytes)
+{
+	return bytes.size() >= g_glb_header_size && readU32(bytes, 0) == g_glb_magic;
+}
+
+std::optional<GlbChunks> splitGlb(const std::span<const std::byte> bytes)
+{
+	if (!isGlb(bytes) || readU32(bytes, 4) != 2)
+	{
+		return std::nullopt;
+	}
+
+	const auto length = std::min<size_t>(readU32(bytes, 8), bytes.size());
+	if (length < g_glb_header_size + g_glb_chunk_header_size)
+	{
+		return std::nullopt;
+	}
+
+	GlbChunks chunks;
+
+	const size_t jsonLength = readU32(bytes, g_glb_header_size);
+	const auto jsonBegin = g_glb_header_size + g_glb_chunk_header_size;
+	if (readU32(bytes, g_glb_header_size + 4) != g_glb_json_chunk || jsonLength > length - jsonBegin)
+	{
+		return std::nullopt;
+	}
+	chunks.json = bytes.subspan(jsonBegin, jsonLength);
+
+	// BIN chunk is optional.
+	const auto binHeader = jsonBegin + jsonLength;
+	if (binHeader + g_glb_chunk_header_size <= length)
+	{
+		const size_t binLength = readU32(bytes, binHeader);
+		const auto binBegin = binHeader + g_glb_chunk_header_size;
+		if (readU32(bytes, binHeader + 4) != g_glb_bin_chunk || binLength > length - binBegin)
+		{
+			return std::nullopt;
+		}
+		chunks.bin = bytes.subspan(binBegin, binLength);
+	}
+
+	return chunks;
+}
+
+std::optional<int> parseViewUri(const std::string & path)
+{
+	const auto pos = path.rfind(g_view_scheme);
+	if (pos == std::string::npos)
+	{
+		return std::nullopt;
+	}
+
+	int index = -1;
+	const auto begin = path.data() + pos + g_view_scheme.size();
+	const auto end = path.data() + path.size();
+	const auto [ptr, ec] = std::from_chars(begin, end, index);
+	if (ec != std::errc{} || ptr != end)
+	{
+		return -1;
+	}
+	return index;
+}
+
+}// namespace
+
+GltfAsset::GltfAsset(const LoadMode mode)
+	: mode_{mode}
+{
+}
+
+GltfAsset::~GltfAsset()
+{
+	if (mapping_)
+	{
+		file_.unmap(mapping_);
+	}
+}
+
+auto GltfAsset::load(const QString & path, const LoadMode mode, QString & error) -> std::unique_ptr<GltfAsset>
+{
+	FGL_TRACE_SCOPE("GltfAsset::load");
+
+	auto asset = std::unique_ptr<GltfAsset>(new GltfAsset(mode));
+	if (!asset->open(path, error))
+	{
+		return nullptr;
+	}
+
+	const auto parsed = mode == LoadMode::Mapped
+		? asset->parseMapped(QFileInfo(path).absolutePath(), error)
+		: asset->parseCopy(error);
+	if (!parsed)
+	{
+		return nullptr;
+	}
+
+	asset->decodeImages();
+	return asset;
+}
+
+bool GltfAsset::open(const QString & path, QString & error)
+{
+	file_.setFileName(path);
+	if (!file_.open(QIODevice::ReadOnly))
+	{
+		error = QString("Failed to open %1: %2").arg(path, file_.errorString());
+		return false;
+	}
+
+	if (mode_ == LoadMode::Mapped)
+	{
+		mapping_ = file_.map(0, file_.size());
+	}
+
+	if (mapping_)
+	{
+		contents_ = {reinterpret_cast<const std::byte *>(mapping_), static_cast<size_t>(file_.size())};
+	}
+	else
+	{
+		// Compressed Qt resources can not be mapped.
+		bytes_ = file_.readAll();
+		contents_ = {reinterpret_cast<const std::byte *>(bytes_.constData()), static_cast<size_t>(bytes_.size())};
+		file_.close();
+	}
+
+	return true;
+}
+
+bool GltfAsset::parseCopy(QString & error)
+{
+	FGL_TRACE_SCOPE("GltfAsset::parseCopy");
+
+	tinygltf::TinyGLTF loader;
+	loader.SetImageLoader(&storeImage, nullptr);
+	std::string err;
+	std::string warn;
+
+	const auto baseDir = QFileInfo(file_.fileName()).absolutePath().toStdString();
+	const auto data = reinterpret_cast<const unsigned char *>(contents_.data());
+	const auto size = static_cast<unsigned int>(contents_.size());
+	const auto ok = isGlb(contents_)
+		? loader.LoadBinaryFromMemory(&model_, &err, &warn, data, size, baseDir)
+		: loader.LoadASCIIFromString(&model_, &err, &warn, reinterpret_cast<const char *>(data), size, baseDir);
+
+	if (!warn.empty())
+	{
+		qWarning() << QString::fromStdString(warn);
+	}
+	if (!ok)
+	{
+		error = QString::fromStdString(err);
+		return false;
+	}
+
+	// Everything was copied into the model.
+	bytes_.clear();
+	contents_ = {};
+	return true;
+}
+
+bool GltfAsset::parseMapped(const QString & baseDir, QString & error)
+{
+	FGL_TRACE_SCOPE("GltfAsset::parseMapped");
+
+	auto json = contents_;
+	if (isGlb(contents_))
+	{
+		const auto chunks = splitGlb(contents_);
+		if (!chunks)
+		{
+			error = "Invalid glTF binary";
+			return false;
+		}
+		json = chunks->json;
+		bin_ = chunks->bin;
+	}
+
+	auto document = nlohmann::json::parse(reinterpret_cast<const char *>(json.data()),
+										  reinterpret_cast<const char *>(json.data() + json.size()),
+										  nullptr, false);
+	if (document.is_discarded() || !document.is_object())
+	{
+		error = "Failed to parse glTF JSON";
+		return false;
+	}
+
+	// Redirect the BIN buffer.
+	if (auto it = document.find("buffers"); it != document.end() && it->is_array() && !bin_.empty())
+	{
+		for (size_t i = 0; i < it->size(); ++i)
+		{
+			auto & buffer = (*it)[i];
+			if (!buffer.is_object() || buffer.contains("uri"))
+			{
+				continue;
+			}
+
+			const auto byteLength = buffer.value("byteLength", size_t{0});
+			if (byteLength > bin_.size())
+			{
+				error = "Invalid `byteLength' of the GLB buffer";
+				return false;
+			}
+			bin_ = bin_.first(byteLength);
+			binBuffer_ = static_cast<int>(i);
+
+			buffer["uri"] = std::string{g_placeholder_uri};
+			buffer["byteLength"] = g_placeholder_size;
+			break;
+		}
+	}
+
+	// Images living in the BIN chunk are read through the FS callbacks.
+	std::vector<std::pair<size_t, int>> redirectedImages;
+	if (auto images = document.find("images"); images != document.end() && images->is_array() && binBuffer_ >= 0)
+	{
+		const auto views = document.find("bufferViews");
+		for (size_t i = 0; i < images->size(); ++i)
+		{
+			auto & image = (*images)[i];
+			if (!image.is_object() || !image.contains("bufferView") || !image["bufferView"].is_number_integer()
+				|| views == document.end() || !views->is_array())
+			{
+				continue;
+			}
+
+			const auto view = image["bufferView"].get<int>();
+			if (view < 0 || static_cast<size_t>(view) >= views->size()
+				|| (*views)[static_cast<size_t>(view)].value("buffer", -1) != binBuffer_)
+			{
+				continue;
+			}
+
+			image.erase("bufferView");
+			image["uri"] = std::string{g_view_scheme} + std::to_string(view);
+			redirectedImages.emplace_back(i, view);
+		}
+	}
+
+	tinygltf::TinyGLTF loader;
+	loader.SetImageLoader(&storeImage, nullptr);
+	loader.SetFsCallbacks({&fileExists, &expandFilePath, &readWholeFile, &tinygltf::WriteWholeFile, &fileSize, this});
+
+	std::string err;
+	std::string warn;
+	const auto text = document.dump();
+	const auto ok = loader.LoadASCIIFromString(&model_, &err, &warn, text.data(), static_cast<unsigned int>(text.size()),
+											   baseDir.toStdString());
+
+	if (!warn.empty())
+	{
+		qWarning() << QString::fromStdString(warn);
+	}
+	if (!ok)
+	{
+		error = QString::fromStdString(err);
+		return false;
+	}
+
+	// Restore what the rewrite changed.
+	if (binBuffer_ >= 0)
+	{
+		auto & buffer = model_.buffers[static_cast<size_t>(binBuffer_)];
+		buffer.data.clear();
+		buffer.data.shrink_to_fit();
+		buffer.uri.clear();
+	}
+	for (const auto & [index, view]: redirectedImages)
+	{
+		auto & image = model_.images[index];
+		image.uri.clear();
+		image.bufferView = view;
+	}
+
+	return true;
+}
+
+void GltfAsset::decodeImages()
+{
+	FGL_TRACE_SCOPE("GltfAsset::decodeImages");
+
+	std::vector<size_t> pending;
+	for (size_t i = 0; i < model_.images.size(); ++i)
+	{
+		if (model_.images[i].as_is && !model_.images[i].image.empty())
+		{
+			pending.push_back(i);
+		}
+	}
+	if (pending.empty())
+	{
+		return;
+	}
+
+	// Workers take the next image until none is left, images are independent.
+	std::atomic<size_t> next{0};
+	std::vector<std::string> errors(pending.size());
+	const auto decode = [&] {
+		for (auto i = next++; i < pending.size(); i = next++)
+		{
+			FGL_TRACE_SCOPE("GltfAsset::decodeImage");
+
+			auto & image = model_.images[pending[i]];
+			const auto encoded = std::move(image.image);
+			image.image.clear();
+			image.as_is = false;
+
+			std::string warn;
+			if (!tinygltf::LoadImageData(&image, static_cast<int>(pending[i]), &errors[i], &warn, 0, 0,
+										 encoded.data(), static_cast<int>(encoded.size()), nullptr))
+			{
+				image.image.clear();
+			}
+		}
+	};
+
+	const auto workers = std::min<size_t>(pending.size(), std::max(std::thread::hardware_concurrency(), 1u));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < workers; ++i)
+	{
+		threads.emplace_back(decode);
+	}
+	decode();
+	for (auto & thread: threads)
+	{
+		thread.join();
+	}
+
+	for (const auto & err: errors)
+	{
+		if (!err.empty())
+		{
+			qWarning() << QString::fromStdString(err);
+		}
+	}
+}
+
+std::span<const std::byte> GltfAsset::buffer(const int index) const noexcept
+{
+	if (index < 0 || static_cast<size_t>(index) >= model_.buffers.size())
+	{
+		return {};
+	}
+	if (index == binBuffer_)
+	{
+		return bin_;
+	}
+
+	const auto & data = model_.buffers[static_cast<size_t>(index)].data;
+	return {reinterpret_cast<const std::byte *>(data.data()), data.size()};
+}
+
+std::span<const std::byte> GltfAsset::bufferView(const int index) const noexcept
+{
+	if (index < 0 || static_cast<size_t>(index) >= model_.bufferViews.size())
+	{
+		return {};
+	}
+
+	const auto & view = model_.bufferViews[static_cast<size_t>(index)];
+	const auto bytes = buffer(view.buffer);
+	if (view.byteOffset > bytes.size() || view.byteLength > bytes.size() - view.byteOffset)
+	{
+		return {};
+	}
+	return bytes.subspan(view.byteOffset, view.byteLength);
+}
+
+QMatrix4x4 GltfAsset::localMatrix(const tinygltf::Node & node)
+{
+	QMatrix4x4 matrix;
+	if (node.matrix.size() == 16)
+	{
+		// glTF matrices are column-major.
+		for (int column = 0; column < 4; ++column)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				matrix(row, column) = static_cast<float>(node.matrix[static_cast<size_t>(column * 4 + row)]);
+			}
+		}
+		return matrix;
+	}
+
+	if (node.translation.size() == 3)
+	{
+		matrix.translate(static_cast<float>(node.translation[0]),
+						 static_cast<float>(node.translation[1]),
+						 static_cast<float>(node.translation[2]));
+	}
+	if (node.rotation.size() == 4)
+	{
+		matrix.rotate(QQuaternion(static_cast<float>(node.rotation[3]),
+								  static_cast<float>(node.rotation[0]),
+								  static_cast<float>(node.rotation[1]),
+								  static_cast<float>(node.rotation[2])));
+	}
+	if (node.scale.size() == 3)
+	{
+		matrix.scale(static_cast<float>(node.scale[0]),
+					 static_cast<float>(node.scale[1]),
+					 static_cast<float>(node.scale[2]));
+	}
+	return matrix;
+}
+
+fgl::AttributeStream GltfAsset::attribute(const int accessor) const noexcept
+{
+	if (accessor < 0 || static_cast<size_t>(accessor) >= model_.accessors.size())
+	{
+		return {};
+	}
+
+	const auto & source = model_.accessors[static_cast<size_t>(accessor)];
+
+	fgl::AttributeStream stream;
+	stream.count = source.count;
+	stream.components = static_cast<uint32_t>(std::max(tinygltf::GetNumComponentsInType(static_cast<uint32_t>(source.type)), 0));
+	stream.normalized = source.normalized;
+	switch (source.componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_FLOAT:
+			stream.type = fgl::ComponentType::Float;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			stream.type = fgl::ComponentType::Byte;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			stream.type = fgl::ComponentType::UnsignedByte;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			stream.type = fgl::ComponentType::Short;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			stream.type = fgl::ComponentType::UnsignedShort;
+			break;
+		default:
+			return {};
+	}
+
+	const auto view = bufferView(source.bufferView);
+	if (view.empty())
+	{
+		return stream;
+	}
+
+	const auto stride = source.ByteStride(model_.bufferViews[static_cast<size_t>(source.bufferView)]);
+	const auto elementSize = stream.components * stream.componentSize();
+	if (stride <= 0 || source.count == 0
+		|| source.byteOffset + (source.count - 1) * static_cast<size_t>(stride) + elementSize > view.size())
+	{
+		return stream;
+	}
+
+	stream.data = view.data() + source.byteOffset;
+	stream.stride = static_cast<size_t>(stride);
+	return stream;
+}
+
+auto GltfAsset::sparse(const int accessor) const -> Sparse
+{
+	if (accessor < 0 || static_cast<size_t>(accessor) >= model_.accessors.size())
+	{
+		return {};
+	}
+
+	const auto & source = model_.accessors[static_cast<size_t>(accessor)];
+	if (!source.sparse.isSparse || source.sparse.count <= 0)
+	{
+		return {};
+	}
+
+	// Values are tightly packed elements of the accessor type.
+	const auto count = static_cast<size_t>(source.sparse.count);
+	auto values = attribute(accessor);
+	const auto elementSize = values.components * values.componentSize();
+	const auto valuesView = bufferView(source.sparse.values.bufferView);
+	if (values.components == 0 || values.count == 0 || source.sparse.values.byteOffset + count * elementSize > valuesView.size())
+	{
+		return {};
+	}
+	values.data = valuesView.data() + source.sparse.values.byteOffset;
+	values.count = count;
+	values.stride = elementSize;
+
+	const auto indexSize = static_cast<size_t>(std::max(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(source.sparse.indices.componentType)), 0));
+	const auto indicesView = bufferView(source.sparse.indices.bufferView);
+	if (indexSize == 0 || source.sparse.indices.byteOffset + count * indexSize > indicesView.size())
+	{
+		return {};
+	}
+
+	Sparse result;
+	result.values = values;
+	result.indices.resize(count);
+	const auto * indices = indicesView.data() + source.sparse.indices.byteOffset;
+	for (size_t i = 0; i < count; ++i)
+	{
+		switch (source.sparse.indices.componentType)
+		{
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				result.indices[i] = std::to_integer<uint32_t>(indices[i]);
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			{
+				uint16_t index;
+				std::memcpy(&index, indices + i * sizeof(index), sizeof(index));
+				result.indices[i] = index;
+				break;
+			}
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+				std::memcpy(&result.indices[i], indices + i * sizeof(uint32_t), sizeof(uint32_t));
+				break;
+			default:
+				return {};
+		}
+	}
+	return result;
+}
+
+bool GltfAsset::storeImage(tinygltf::Image * image, int, std::string *, std::string *, int, int,
+						   const unsigned char * bytes, const int size, void *)
+{
+	// Keep the encoded bytes, decodeImages() decodes them all in parallel after parsing.
+	image->image.assign(bytes, bytes + size);
+	image->as_is = true;
+	return true;
+}
+
+bool GltfAsset::fileExists(const std::string & path, void * self)
+{
+	if (const auto view = parseViewUri(path))
+	{
+		return !static_cast<GltfAsset *>(self)->bufferView(*view).empty();
+	}
+	return tinygltf::FileExists(path, nullptr);
+}
+
+std::string GltfAsset::expandFilePath(const std::string & path, void *)
+{
+	if (parseViewUri(path))
+	{
+		return path;
+	}
+	return tinygltf::ExpandFilePath(path, nullptr);
+}
+
+bool GltfAsset::readWholeFile(std::vector<unsigned char> * out, std::string * err, const std::string & path, void * self)
+{
+	if (const auto view = parseViewUri(path))
+	{
+		const auto bytes = static_cast<GltfAsset *>(self)->bufferView(*view);
+		const auto begin = reinterpret_cast<const unsigned char *>(bytes.data());
+		out->assign(begin, begin + bytes.size());
+		return !bytes.empty();
+	}
+	return tinygltf::ReadWholeFile(out, err, path, nullptr);
+}
+
+bool GltfAsset::fileSize(size_t * size, std::string * err, const std::string & path, void * self)
+{
+	if (const auto view = parseViewUri(path))
+	{
+		*size = static_cast<GltfAsset *>(self)->bufferView(*view).size();
+		return true;
+	}
+	return tinygltf::GetFileSizeInBytes(size, err, path, nullptr);
+}
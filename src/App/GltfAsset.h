@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Base/MorphBlender.hpp>
+
+#include <QByteArray>
+#include <QFile>
+#include <QMatrix4x4>
+#include <QString>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+class GltfAsset final
+{
+public:
+	enum class LoadMode
+	{
+		// Read the whole file and let tinygltf copy every chunk into Buffer::data.
+		Copy,
+		// Map the file, parse only the JSON chunk and serve the BIN chunk from the mapping.
+		Mapped,
+	};
+
+	[[nodiscard]] static std::unique_ptr<GltfAsset> load(const QString & path, LoadMode mode, QString & error);
+
+	GltfAsset(const GltfAsset &) = delete;
+	GltfAsset(GltfAsset &&) = delete;
+
+	GltfAsset & operator=(const GltfAsset &) = delete;
+	GltfAsset & operator=(GltfAsset &&) = delete;
+
+	~GltfAsset();
+
+public:
+	[[nodiscard]] const tinygltf::Model & model() const noexcept { return model_; }
+	[[nodiscard]] LoadMode mode() const noexcept { return mode_; }
+	[[nodiscard]] bool mapped() const noexcept { return mapping_ != nullptr; }
+
+	// Bytes of a buffer or buffer view. Empty span if the index is out of range.
+	[[nodiscard]] std::span<const std::byte> buffer(int index) const noexcept;
+	[[nodiscard]] std::span<const std::byte> bufferView(int index) const noexcept;
+
+	// Accessor data as a stream. Null data for accessors without a buffer view.
+	[[nodiscard]] fgl::AttributeStream attribute(int accessor) const noexcept;
+
+	// Sparse substitutions of an accessor: ascending element indices and a packed stream of their values.
+	struct Sparse {
+		std::vector<uint32_t> indices;
+		fgl::AttributeStream values;
+	};
+
+	// Empty indices if the accessor is not sparse or its sparse storage is out of bounds.
+	[[nodiscard]] Sparse sparse(int accessor) const;
+
+	// Transform of a node relative to its parent.
+	[[nodiscard]] static QMatrix4x4 localMatrix(const tinygltf::Node & node);
+
+private:
+	explicit GltfAsset(LoadMode mode);
+
+	bool open(const QString & path, QString & error);
+	bool parseCopy(QString & error);
+	bool parseMapped(const QString & baseDir, QString & error);
+	void decodeImages();
+
+	static bool storeImage(tinygltf::Image * image, int index, std::string * err, std::string * warn, int width,
+						   int height, const unsigned char * bytes, int size, void * self);
+	static bool fileExists(const std::string & path, void * self);
+	static std::string expandFilePath(const std::string & path, void * self);
+	static bool readWholeFile(std::vector<unsigned char> * out, std::string * err, const std::string & path, void * self);
+	static bool fileSize(size_t * size, std::string * err, const std::string & path, void * self);
+
+private:
+	LoadMode mode_;
+
+	QFile file_;
+	uchar * mapping_ = nullptr;
+	QByteArray bytes_;
+	std::span<const std::byte> contents_;
+
+	// GLB BIN chunk and the buffer that refers to it.
+	std::span<const std::byte> bin_;
+	int binBuffer_ = -1;
+
+	tinygltf::Model model_;
+};
@@ -0,0 +1,1579 @@
+#include "GltfScene.h"
+
+#include <Base/Trace.hpp>
+
+#include <QImage>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+
+// Dense morph targets are kept as (index, delta) pairs when at most 1/g_sparse_ratio of the vertices move.
+constexpr size_t g_sparse_ratio = 4;
+
+// Texels per row of the joint matrix texture.
+constexpr size_t g_joint_texture_width = 1024;
+
+// Fewest visible batches worth a sort key job.
+constexpr size_t g_batch_grain = 64;
+
+// Bounds from accessor min and max, which glTF requires for positions but not every exporter writes.
+fgl::Aabb accessorBounds(const tinygltf::Model & model, const int index)
+{
+	if (index < 0 || static_cast<size_t>(index) >= model.accessors.size())
+	{
+		return fgl::Aabb::unbounded();
+	}
+	const auto & accessor = model.accessors[static_cast<size_t>(index)];
+	if (accessor.minValues.size() != 3 || accessor.maxValues.size() != 3)
+	{
+		return fgl::Aabb::unbounded();
+	}
+
+	fgl::Aabb bounds;
+	for (size_t axis = 0; axis < 3; ++axis)
+	{
+		bounds.min[axis] = static_cast<float>(accessor.minValues[axis]);
+		bounds.max[axis] = static_cast<float>(accessor.maxValues[axis]);
+	}
+	return bounds;
+}
+
+}// namespace
+
+void GltfScene::begin(const GltfAsset & asset, const MorphMode morphMode)
+{
+	FGL_TRACE_SCOPE("GltfScene::begin");
+
+	initializeOpenGLFunctions();
+	destroy();
+
+	asset_ = &asset;
+	morphMode_ = morphMode;
+
+	const auto & model = asset.model();
+	buffers_.resize(model.bufferViews.size());
+	textures_.resize(model.textures.size());
+	prepareMeshes(asset);
+
+	constexpr auto max = std::numeric_limits<float>::max();
+	boundsMin_ = QVector3D(max, max, max);
+	boundsMax_ = -boundsMin_;
+
+	if (model.scenes.empty())
+	{
+		return;
+	}
+
+	// Draws and bounds are known up front, meshes show up as they are uploaded.
+	const auto scene = model.defaultScene >= 0 ? static_cast<size_t>(model.defaultScene) : 0;
+	graphNodes_.assign(model.nodes.size(), fgl::SceneGraph::g_none);
+	for (const auto node: model.scenes[scene].nodes)
+	{
+		collectDraws(model, node, fgl::SceneGraph::g_none);
+	}
+	createSkins(asset);
+	assignSkins(model);
+	updateSkins(true, nullptr);
+	createInstances();
+}
+
+void GltfScene::begin(const SceneCache & cache)
+{
+	FGL_TRACE_SCOPE("GltfScene::begin");
+
+	initializeOpenGLFunctions();
+	destroy();
+
+	cache_ = &cache;
+
+	// Cached scenes have no morph targets.
+	meshes_.resize(cache.meshCount());
+	weights_.resize(cache.meshCount());
+	activeTargets_.resize(cache.meshCount());
+	morphsDirty_.assign(cache.meshCount(), false);
+	textures_.resize(cache.textures().size());
+
+	restBounds_.resize(cache.meshCount());
+	targetBounds_.resize(cache.meshCount());
+	for (const auto & primitive: cache.primitives())
+	{
+		restBounds_[primitive.mesh].grow({{primitive.boundsMin[0], primitive.boundsMin[1], primitive.boundsMin[2]},
+										  {primitive.boundsMax[0], primitive.boundsMax[1], primitive.boundsMax[2]}});
+	}
+	meshBounds_ = restBounds_;
+
+	for (const auto & draw: cache.draws())
+	{
+		draws_.push_back({draw.mesh, fgl::fromElements(draw.world)});
+	}
+	boundsMin_ = cache.boundsMin();
+	boundsMax_ = cache.boundsMax();
+	createInstances();
+}
+
+bool GltfScene::upload(const size_t budget)
+{
+	if (!asset_ && !cache_)
+	{
+		return true;
+	}
+
+	FGL_TRACE_SCOPE("GltfScene::upload");
+
+	// Geometry goes first so the scene takes shape before it gets textured.
+	const auto start = uploadedBytes_;
+	do
+	{
+		if (nextMesh_ < meshes_.size() && cache_)
+		{
+			createCachedGeometry(*cache_);
+		}
+		else if (nextMesh_ < meshes_.size())
+		{
+			createMesh(*asset_, nextMesh_++);
+		}
+		else if (nextTexture_ < textures_.size() && cache_)
+		{
+			createCachedTexture(*cache_, nextTexture_++);
+		}
+		else if (nextTexture_ < textures_.size())
+		{
+			createTexture(*asset_, nextTexture_++);
+		}
+		else
+		{
+			break;
+		}
+	} while (uploadedBytes_ - start < budget);
+
+	return uploaded();
+}
+
+void GltfScene::destroy()
+{
+	asset_ = nullptr;
+	cache_ = nullptr;
+	nextMesh_ = 0;
+	nextTexture_ = 0;
+	uploadedBytes_ = 0;
+	draws_.clear();
+	graph_.clear();
+	graphNodes_.clear();
+	nodeDraws_.clear();
+	batches_.clear();
+	instanceMatrices_.clear();
+	instanceBuffer_.reset();
+	visibleBatches_.clear();
+	batchDepths_.clear();
+	visible_.clear();
+	uploadedVisible_.clear();
+	restBounds_.clear();
+	targetBounds_.clear();
+	meshBounds_.clear();
+	bvh_.clear();
+	weights_.clear();
+	activeTargets_.clear();
+	morphsDirty_.clear();
+	blendedMorphs_.clear();
+	skinning_.clear();
+	skins_.clear();
+	changedSkins_.clear();
+	jointStrides_.clear();
+	jointTexels_.clear();
+	jointTexture_.reset();
+	jointsDirty_ = false;
+	meshes_.clear();
+	textures_.clear();
+	buffers_.clear();
+}
+
+void GltfScene::draw(ShaderVariants & shaders, fgl::UniformRing & uniforms, const fgl::Mat4 & viewProjection,
+					 QOpenGLTexture & fallbackTexture, fgl::JobSystem & jobs)
+{
+	FGL_TRACE_SCOPE("GltfScene::draw");
+
+	cull(viewProjection, jobs);
+	if (!uploadJoints())
+	{
+		// Skinned meshes fell back to rigid, their instances need the node worlds.
+		cull(viewProjection, jobs);
+	}
+	sortDraws(shaders, viewProjection, jobs);
+
+	// Uniforms of every draw call in one mapping, draws only bind their range.
+	if (!uniforms.beginFrame(queue_.size() * uniforms.alignedSize(sizeof(DrawUniforms))))
+	{
+		return;
+	}
+	uniformOffsets_.clear();
+	for (const auto & item: queue_.items())
+	{
+		const auto & command = commands_[item.command];
+		const auto mesh = visibleBatches_[command.batch].mesh;
+		const auto & primitive = meshes_[mesh][command.primitive];
+		const auto & active = activeTargets_[mesh];
+
+		DrawUniforms block;
+		if (primitive.quantized)
+		{
+			block.positionOffset = {primitive.positionOffset.x(), primitive.positionOffset.y(), primitive.positionOffset.z(), 0.0f};
+			block.positionScale = {primitive.positionScale.x(), primitive.positionScale.y(), primitive.positionScale.z(), 0.0f};
+		}
+		if (!primitive.hasColors)
+		{
+			block.baseColor = {primitive.color.x(), primitive.color.y(), primitive.color.z(), 1.0f};
+		}
+		if (primitive.gpuMorph && active.count > 0)
+		{
+			block.morphParams = {active.count, primitive.gpuMorph->vertices, 0, 0};
+			block.morphTargets = active.targets;
+			block.morphWeights = active.weights;
+		}
+		if (primitive.skinned)
+		{
+			block.skinParams = {visibleBatches_[command.batch].firstJoint, static_cast<GLint>(jointStrides_[mesh]), 0, 0};
+		}
+		uniformOffsets_.push_back(uniforms.write(std::as_bytes(std::span{&block, 1})));
+	}
+	uniforms.flush();
+
+	// State is only bound where it differs from the previous draw and released once at the end.
+	submitStats_ = {};
+	QOpenGLShaderProgram * boundProgram = nullptr;
+	QOpenGLVertexArrayObject * boundVao = nullptr;
+	QOpenGLTexture * boundTexture = nullptr;
+	QOpenGLTexture * boundDeltas = nullptr;
+	if (jointTexture_)
+	{
+		jointTexture_->bind(2);
+	}
+	const auto bind = [&](auto * & bound, auto * object, auto && binder) {
+		if (bound == object)
+		{
+			++submitStats_.bindsAvoided;
+			return;
+		}
+		binder();
+		bound = object;
+		++submitStats_.binds;
+	};
+
+	auto offset = uniformOffsets_.begin();
+	for (const auto & item: queue_.items())
+	{
+		const auto & command = commands_[item.command];
+		const auto & batch = visibleBatches_[command.batch];
+		const auto & primitive = meshes_[batch.mesh][command.primitive];
+		const auto & variant = *command.variant;
+
+		// The view-projection matrix is set once per program and frame.
+		bind(boundProgram, variant.program.get(), [&] {
+			variant.program->bind();
+			glUniformMatrix4fv(variant.viewProjectionUniform, 1, GL_FALSE, fgl::elements(viewProjection).data());
+		});
+
+		uniforms.bindRange(g_draw_uniforms_binding, *offset++, sizeof(DrawUniforms));
+		if (primitive.gpuMorph)
+		{
+			auto * deltas = primitive.gpuMorph->deltas.get();
+			bind(boundDeltas, deltas, [&] { deltas->bind(1); });
+		}
+
+		if (primitive.features & ShaderVariants::Texture)
+		{
+			auto * texture = textures_[static_cast<size_t>(primitive.texture)]
+				? textures_[static_cast<size_t>(primitive.texture)].get()
+				: &fallbackTexture;
+			bind(boundTexture, texture, [&] { texture->bind(0); });
+			++submitStats_.releasesAvoided;
+		}
+
+		// Every primitive belongs to one batch, so its instance range changes with the VAO.
+		bind(boundVao, primitive.vao.get(), [&] {
+			primitive.vao->bind();
+			bindInstances(batch.firstInstance);
+		});
+		++submitStats_.releasesAvoided;
+
+		if (primitive.indexed)
+		{
+			glDrawElementsInstanced(primitive.mode, primitive.count, primitive.indexType,
+									reinterpret_cast<const void *>(primitive.indexOffset), batch.instances);
+		}
+		else
+		{
+			glDrawArraysInstanced(primitive.mode, 0, primitive.count, batch.instances);
+		}
+		++submitStats_.draws;
+	}
+
+	// A draw-by-draw loop releases the texture and the VAO after every draw using them, this only once.
+	if (boundTexture)
+	{
+		boundTexture->release(0);
+		--submitStats_.releasesAvoided;
+	}
+	if (boundVao)
+	{
+		boundVao->release();
+		--submitStats_.releasesAvoided;
+	}
+
+	if (jointTexture_)
+	{
+		jointTexture_->release(2);
+	}
+	if (boundProgram)
+	{
+		boundProgram->release();
+	}
+	uniforms.endFrame();
+}
+
+void GltfScene::sortDraws(ShaderVariants & shaders, const fgl::Mat4 & viewProjection, fgl::JobSystem & jobs)
+{
+	FGL_TRACE_SCOPE("GltfScene::sortDraws");
+
+	// Clip-space w of the nearest visible instance, the dot product with the matrix's last row.
+	const fgl::Vec4 clipW(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	batchDepths_.resize(visibleBatches_.size());
+	jobs.parallelFor(visibleBatches_.size(), g_batch_grain, [&](const size_t begin, const size_t end) {
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto & batch = visibleBatches_[i];
+			auto depth = std::numeric_limits<float>::max();
+			for (auto instance = batch.firstInstance; instance < batch.firstInstance + static_cast<size_t>(batch.instances); ++instance)
+			{
+				const auto & box = bvh_.box(visible_[instance]);
+				const fgl::Vec4 center((box.min[0] + box.max[0]) * 0.5f, (box.min[1] + box.max[1]) * 0.5f,
+									   (box.min[2] + box.max[2]) * 0.5f, 1.0f);
+				depth = std::min(depth, glm::dot(clipW, center));
+			}
+			batchDepths_[i] = depth;
+		}
+	});
+
+	// Variants may be built on first use, so commands are made on this thread.
+	commands_.clear();
+	queue_.clear();
+	for (size_t i = 0; i < visibleBatches_.size(); ++i)
+	{
+		const auto & batch = visibleBatches_[i];
+		const auto depth = batchDepths_[i];
+
+		// GPU morphing only pays for as many targets as the mesh has active.
+		const auto morphFeatures = ShaderVariants::morphTargets(static_cast<size_t>(activeTargets_[batch.mesh].count));
+		const auto & primitives = meshes_[batch.mesh];
+		for (size_t primitive = 0; primitive < primitives.size(); ++primitive)
+		{
+			const auto & source = primitives[primitive];
+			const auto * variant = shaders.variant(source.features | (source.gpuMorph ? morphFeatures : 0u));
+			if (!variant)
+			{
+				continue;
+			}
+
+			const auto texture = source.texture;
+			const auto material = (source.features & ShaderVariants::Texture) && textures_[static_cast<size_t>(texture)]
+				? static_cast<uint32_t>(texture) + 1
+				: 0;
+			queue_.push(fgl::RenderQueue::key(variant->id, material, source.vao->objectId(), depth),
+						static_cast<uint32_t>(commands_.size()));
+			commands_.push_back({i, primitive, variant});
+		}
+	}
+	queue_.sort();
+}
+
+size_t GltfScene::drawCallCount() const noexcept
+{
+	size_t count = 0;
+	for (const auto & batch: batches_)
+	{
+		count += meshes_[batch.mesh].size();
+	}
+	return count;
+}
+
+void GltfScene::setMorphWeights(const size_t mesh, const std::span<const float> weights)
+{
+	auto & current = weights_[mesh];
+	const auto count = std::min(current.size(), weights.size());
+	if (std::equal(weights.begin(), weights.begin() + static_cast<std::ptrdiff_t>(count), current.begin()))
+	{
+		return;
+	}
+
+	std::copy_n(weights.begin(), count, current.begin());
+	morphsDirty_[mesh] = true;
+}
+
+void GltfScene::updateMorphs(fgl::JobSystem & jobs)
+{
+	FGL_TRACE_SCOPE("GltfScene::updateMorphs");
+
+	blendedMorphs_.clear();
+	for (size_t mesh = 0; mesh < meshes_.size(); ++mesh)
+	{
+		if (!morphsDirty_[mesh])
+		{
+			continue;
+		}
+		morphsDirty_[mesh] = false;
+
+		// GPU morphing only needs the active weights.
+		selectActiveTargets(mesh);
+		if (!weights_[mesh].empty())
+		{
+			updateBounds(mesh);
+		}
+
+		for (auto & primitive: meshes_[mesh])
+		{
+			if (!primitive.morph)
+			{
+				continue;
+			}
+
+			blendedMorphs_.emplace_back(primitive.morph.get(), mesh);
+		}
+	}
+	if (blendedMorphs_.empty())
+	{
+		return;
+	}
+
+	// A job per primitive, which splits its vertices into more, so one large mesh spreads as well as many
+	// small ones. Sparse targets scatter into the primitive's own output after its blocks are blended.
+	jobs.parallelFor(blendedMorphs_.size(), 1, [&](const size_t begin, const size_t end) {
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto & [morph, mesh] = blendedMorphs_[i];
+			blender_.blend(morph->base, morph->targets, weights_[mesh], morph->blended, &jobs);
+			blender_.scatter(morph->sparseTargets, weights_[mesh], morph->base.components, morph->blended);
+		}
+	});
+
+	for (const auto & [morph, mesh]: blendedMorphs_)
+	{
+		// Orphan the previous storage so the driver never waits for pending draws.
+		morph->buffer->bind();
+		morph->buffer->allocate(morph->blended.data(), static_cast<int>(morph->blended.size() * sizeof(float)));
+		morph->buffer->release();
+	}
+}
+
+void GltfScene::setNodeTranslation(const size_t node, const std::span<const float, 3> translation)
+{
+	if (node < graphNodes_.size() && graphNodes_[node] != fgl::SceneGraph::g_none)
+	{
+		graph_.setTranslation(graphNodes_[node], translation);
+	}
+}
+
+void GltfScene::setNodeRotation(const size_t node, const std::span<const float, 4> rotation)
+{
+	if (node < graphNodes_.size() && graphNodes_[node] != fgl::SceneGraph::g_none)
+	{
+		graph_.setRotation(graphNodes_[node], rotation);
+	}
+}
+
+void GltfScene::setNodeScale(const size_t node, const std::span<const float, 3> scale)
+{
+	if (node < graphNodes_.size() && graphNodes_[node] != fgl::SceneGraph::g_none)
+	{
+		graph_.setScale(graphNodes_[node], scale);
+	}
+}
+
+void GltfScene::updateTransforms(fgl::JobSystem & jobs)
+{
+	FGL_TRACE_SCOPE("GltfScene::updateTransforms");
+
+	// Still scenes stop here.
+	const auto changed = graph_.update();
+	if (changed.empty())
+	{
+		return;
+	}
+
+	auto moved = false;
+	for (const auto node: changed)
+	{
+		const auto i = nodeDraws_[node];
+		if (i == fgl::SceneGraph::g_none || draws_[i].skin >= 0)
+		{
+			continue;
+		}
+		draws_[i].world = fgl::fromElements(graph_.world(node));
+		const auto world = fgl::elements(draws_[i].world);
+		std::copy(world.begin(), world.end(), instanceMatrices_.begin() + static_cast<std::ptrdiff_t>(size_t{i} * 16));
+		bvh_.update(i, drawBounds(i));
+		moved = true;
+	}
+
+	// Joints move skinned draws, so their bounds come after the palettes.
+	if (updateSkins(false, &jobs))
+	{
+		for (size_t i = 0; i < draws_.size(); ++i)
+		{
+			if (draws_[i].skin >= 0 && skins_[static_cast<size_t>(draws_[i].skin)].changed)
+			{
+				bvh_.update(static_cast<uint32_t>(i), drawBounds(i));
+			}
+		}
+	}
+
+	// Visible instances are uploaded again even if the set did not change.
+	if (moved)
+	{
+		uploadedVisible_.clear();
+	}
+}
+
+void GltfScene::createSkins(const GltfAsset & asset)
+{
+	const auto & model = asset.model();
+	for (const auto & source: model.skins)
+	{
+		Skin skin;
+		for (const auto joint: source.joints)
+		{
+			skin.joints.push_back(joint >= 0 && static_cast<size_t>(joint) < graphNodes_.size()
+									  ? graphNodes_[static_cast<size_t>(joint)]
+									  : fgl::SceneGraph::g_none);
+		}
+
+		// Without inverse bind matrices they are identities.
+		const auto joints = skin.joints.size();
+		std::vector<float> inverseBinds(joints * 16, 0.0f);
+		for (size_t joint = 0; joint < joints; ++joint)
+		{
+			for (size_t i = 0; i < 4; ++i)
+			{
+				inverseBinds[joint * 16 + i * 5] = 1.0f;
+			}
+		}
+		const auto stream = asset.attribute(source.inverseBindMatrices);
+		if (stream.data && stream.components == 16 && stream.count >= joints)
+		{
+			blender_.blend(stream, {}, {}, inverseBinds);
+		}
+
+		skinning_.add(inverseBinds);
+		skin.worlds.resize(joints * 16);
+		skin.matrices.resize(joints * fgl::Skinning::g_matrix_size);
+		skins_.push_back(std::move(skin));
+	}
+}
+
+void GltfScene::assignSkins(const tinygltf::Model & model)
+{
+	// Instances of a mesh share the variants of its primitives, and skinned instances have no world matrix of
+	// their own. So a mesh is only skinned if every primitive drawn has joint attributes and every node
+	// drawing it has a skin. Anything else is drawn rigid.
+	std::vector<bool> rigid(model.meshes.size());
+	for (size_t mesh = 0; mesh < model.meshes.size(); ++mesh)
+	{
+		const auto & primitives = model.meshes[mesh].primitives;
+		const auto skinnable = [](const tinygltf::Primitive & primitive) {
+			return primitive.attributes.count("POSITION") == 0
+				|| (primitive.attributes.count("JOINTS_0") > 0 && primitive.attributes.count("WEIGHTS_0") > 0);
+		};
+		rigid[mesh] = primitives.empty() || !std::all_of(primitives.begin(), primitives.end(), skinnable);
+	}
+
+	for (const auto & draw: draws_)
+	{
+		if (draw.skin < 0)
+		{
+			rigid[draw.mesh] = true;
+			continue;
+		}
+		jointStrides_[draw.mesh] = std::max(jointStrides_[draw.mesh], skins_[static_cast<size_t>(draw.skin)].joints.size());
+	}
+
+	for (size_t mesh = 0; mesh < rigid.size(); ++mesh)
+	{
+		if (rigid[mesh])
+		{
+			drawRigid(mesh);
+		}
+	}
+}
+
+void GltfScene::drawRigid(const size_t mesh)
+{
+	jointStrides_[mesh] = 0;
+	for (auto & primitive: meshes_[mesh])
+	{
+		if (!primitive.skinned)
+		{
+			continue;
+		}
+		primitive.vao->bind();
+		glDisableVertexAttribArray(g_joints_location);
+		glDisableVertexAttribArray(g_weights_location);
+		primitive.vao->release();
+		primitive.skinned = false;
+		primitive.features &= ~ShaderVariants::Skin;
+	}
+
+	for (size_t i = 0; i < draws_.size(); ++i)
+	{
+		auto & draw = draws_[i];
+		if (draw.mesh != mesh || draw.skin < 0)
+		{
+			continue;
+		}
+		draw.skin = -1;
+		draw.world = fgl::fromElements(graph_.world(draw.node));
+
+		// Before createInstances() the draws are all there is.
+		if (instanceMatrices_.size() >= (i + 1) * 16)
+		{
+			const auto world = fgl::elements(draw.world);
+			std::copy(world.begin(), world.end(), instanceMatrices_.begin() + static_cast<std::ptrdiff_t>(i * 16));
+			bvh_.update(static_cast<uint32_t>(i), drawBounds(i));
+			uploadedVisible_.clear();
+		}
+	}
+}
+
+bool GltfScene::updateSkins(const bool all, fgl::JobSystem * const jobs)
+{
+	FGL_TRACE_SCOPE("GltfScene::updateSkins");
+
+	changedSkins_.clear();
+	for (size_t i = 0; i < skins_.size(); ++i)
+	{
+		auto & skin = skins_[i];
+		skin.changed = all || std::any_of(skin.joints.begin(), skin.joints.end(), [&](const uint32_t node) {
+			return node != fgl::SceneGraph::g_none && graph_.changed(node);
+		});
+		if (skin.changed)
+		{
+			changedSkins_.push_back(i);
+		}
+	}
+
+	// Skins only write their own matrices.
+	const auto updateRange = [&](const size_t begin, const size_t end) {
+		constexpr std::array<float, 16> identity{1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+												 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+		for (auto i = begin; i < end; ++i)
+		{
+			auto & skin = skins_[changedSkins_[i]];
+			for (size_t joint = 0; joint < skin.joints.size(); ++joint)
+			{
+				const auto node = skin.joints[joint];
+				const auto world = node != fgl::SceneGraph::g_none ? graph_.world(node) : identity;
+				std::copy(world.begin(), world.end(), skin.worlds.begin() + static_cast<std::ptrdiff_t>(joint * 16));
+			}
+			skinning_.palette(changedSkins_[i], skin.worlds, skin.matrices);
+		}
+	};
+	if (jobs)
+	{
+		jobs->parallelFor(changedSkins_.size(), 1, updateRange);
+	}
+	else
+	{
+		updateRange(0, changedSkins_.size());
+	}
+
+	const auto updated = !changedSkins_.empty();
+	jointsDirty_ = jointsDirty_ || updated;
+	return updated;
+}
+
+bool GltfScene::uploadJoints()
+{
+	if (!jointsDirty_)
+	{
+		return true;
+	}
+	jointsDirty_ = false;
+
+	FGL_TRACE_SCOPE("GltfScene::uploadJoints");
+
+	// Every visible instance of a skinned mesh gets a run of joints, the shader finds it by instance ID.
+	constexpr auto matrixSize = fgl::Skinning::g_matrix_size;
+	jointTexels_.clear();
+	for (auto & batch: visibleBatches_)
+	{
+		const auto stride = jointStrides_[batch.mesh];
+		batch.firstJoint = static_cast<GLint>(jointTexels_.size() / matrixSize);
+		if (stride == 0)
+		{
+			continue;
+		}
+		for (auto instance = batch.firstInstance; instance < batch.firstInstance + static_cast<size_t>(batch.instances); ++instance)
+		{
+			// Skins with fewer joints than the stride leave the rest zero, no vertex refers to them.
+			const auto & matrices = skins_[static_cast<size_t>(draws_[visible_[instance]].skin)].matrices;
+			const auto offset = static_cast<std::ptrdiff_t>(jointTexels_.size());
+			jointTexels_.resize(jointTexels_.size() + stride * matrixSize);
+			std::copy(matrices.begin(), matrices.end(), jointTexels_.begin() + offset);
+		}
+	}
+	if (jointTexels_.empty())
+	{
+		return true;
+	}
+
+	const auto texels = jointTexels_.size() / 4;
+	const auto height = (texels + g_joint_texture_width - 1) / g_joint_texture_width;
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (height > static_cast<size_t>(maxSize))
+	{
+		qWarning() << "Joint matrices of" << jointTexels_.size() / matrixSize << "instances exceed the texture size limit, skinned meshes are drawn rigid";
+		for (size_t mesh = 0; mesh < jointStrides_.size(); ++mesh)
+		{
+			if (jointStrides_[mesh] > 0)
+			{
+				drawRigid(mesh);
+			}
+		}
+		jointTexels_.clear();
+		return false;
+	}
+
+	jointTexels_.resize(height * g_joint_texture_width * 4, 0.0f);
+	if (!jointTexture_ || static_cast<size_t>(jointTexture_->height()) < height)
+	{
+		// Grows by powers of two, so culling changes rarely reallocate it.
+		size_t rows = 1;
+		while (rows < height)
+		{
+			rows *= 2;
+		}
+		rows = std::min(rows, static_cast<size_t>(maxSize));
+		jointTexture_ = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2D);
+		jointTexture_->setFormat(QOpenGLTexture::RGBA32F);
+		jointTexture_->setSize(static_cast<int>(g_joint_texture_width), static_cast<int>(rows));
+		jointTexture_->setMipLevels(1);
+		jointTexture_->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::Float32);
+		jointTexture_->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+	}
+	jointTexture_->bind();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(g_joint_texture_width), static_cast<GLsizei>(height),
+					GL_RGBA, GL_FLOAT, jointTexels_.data());
+	jointTexture_->release();
+	return true;
+}
+
+void GltfScene::selectActiveTargets(const size_t mesh)
+{
+	const auto & weights = weights_[mesh];
+	auto & active = activeTargets_[mesh];
+
+	targetOrder_.resize(weights.size());
+	std::iota(targetOrder_.begin(), targetOrder_.end(), size_t{0});
+
+	const auto count = std::min(weights.size(), g_max_active_targets);
+	std::partial_sort(targetOrder_.begin(), targetOrder_.begin() + static_cast<std::ptrdiff_t>(count), targetOrder_.end(),
+					  [&](const size_t lhs, const size_t rhs) {
+						  return std::abs(weights[lhs]) > std::abs(weights[rhs]);
+					  });
+
+	active.count = 0;
+	for (size_t i = 0; i < count && weights[targetOrder_[i]] != 0.0f; ++i)
+	{
+		active.targets[i] = static_cast<GLint>(targetOrder_[i]);
+		active.weights[i] = weights[targetOrder_[i]];
+		++active.count;
+	}
+}
+
+void GltfScene::createInstances()
+{
+	FGL_TRACE_SCOPE("GltfScene::createInstances");
+
+	// Draws of a mesh become adjacent, so visible instances of a mesh are one range of the instance buffer.
+	std::stable_sort(draws_.begin(), draws_.end(), [](const Draw & lhs, const Draw & rhs) {
+		return lhs.mesh < rhs.mesh;
+	});
+
+	std::vector<fgl::Aabb> bounds;
+	bounds.reserve(draws_.size());
+	instanceMatrices_.reserve(draws_.size() * 16);
+	for (size_t i = 0; i < draws_.size(); ++i)
+	{
+		if (batches_.empty() || batches_.back().mesh != draws_[i].mesh)
+		{
+			batches_.push_back({draws_[i].mesh, i, 0});
+		}
+		++batches_.back().instances;
+
+		const auto world = fgl::elements(draws_[i].world);
+		instanceMatrices_.insert(instanceMatrices_.end(), world.begin(), world.end());
+		bounds.push_back(drawBounds(i));
+	}
+	bvh_.build(bounds);
+
+	nodeDraws_.assign(graph_.size(), fgl::SceneGraph::g_none);
+	for (size_t i = 0; i < draws_.size(); ++i)
+	{
+		if (draws_[i].node != fgl::SceneGraph::g_none)
+		{
+			nodeDraws_[draws_[i].node] = static_cast<uint32_t>(i);
+		}
+	}
+
+	if (draws_.empty())
+	{
+		return;
+	}
+	// Filled by cull() whenever the visible set changes.
+	instanceBuffer_ = std::make_unique<QOpenGLBuffer>(QOpenGLBuffer::Type::VertexBuffer);
+	instanceBuffer_->create();
+	instanceBuffer_->setUsagePattern(QOpenGLBuffer::StreamDraw);
+}
+
+void GltfScene::updateBounds(const size_t mesh)
+{
+	// Conservative: every target moves the box by its weighted delta range, whether it is active or not.
+	auto bounds = restBounds_[mesh];
+	const auto & weights = weights_[mesh];
+	for (size_t target = 0; target < targetBounds_[mesh].size() && !bounds.empty(); ++target)
+	{
+		const auto & deltas = targetBounds_[mesh][target];
+		for (size_t axis = 0; axis < 3 && weights[target] != 0.0f; ++axis)
+		{
+			const auto a = weights[target] * deltas.min[axis];
+			const auto b = weights[target] * deltas.max[axis];
+			bounds.min[axis] += std::min(a, b);
+			bounds.max[axis] += std::max(a, b);
+		}
+	}
+	meshBounds_[mesh] = bounds;
+
+	const auto batch = std::lower_bound(batches_.begin(), batches_.end(), mesh, [](const Batch & lhs, const size_t rhs) {
+		return lhs.mesh < rhs;
+	});
+	if (batch == batches_.end() || batch->mesh != mesh)
+	{
+		return;
+	}
+	for (auto i = batch->firstInstance; i < batch->firstInstance + static_cast<size_t>(batch->instances); ++i)
+	{
+		bvh_.update(static_cast<uint32_t>(i), drawBounds(i));
+	}
+}
+
+fgl::Aabb GltfScene::drawBounds(const size_t draw) const
+{
+	const auto & bounds = meshBounds_[draws_[draw].mesh];
+	const auto skin = draws_[draw].skin;
+	if (skin < 0)
+	{
+		return bounds.transformed(std::span<const float, 16>(instanceMatrices_.data() + draw * 16, 16));
+	}
+
+	// A skinned vertex is a weighted average of its joints' transforms of it, so it stays inside the box
+	// around the mesh bounds transformed by every joint.
+	fgl::Aabb result;
+	const auto & matrices = skins_[static_cast<size_t>(skin)].matrices;
+	for (size_t joint = 0; joint < matrices.size() / fgl::Skinning::g_matrix_size; ++joint)
+	{
+		const auto * rows = matrices.data() + joint * fgl::Skinning::g_matrix_size;
+		const std::array<float, 16> matrix{rows[0], rows[4], rows[8], 0.0f, rows[1], rows[5], rows[9], 0.0f,
+										   rows[2], rows[6], rows[10], 0.0f, rows[3], rows[7], rows[11], 1.0f};
+		result.grow(bounds.transformed(matrix));
+	}
+	return result;
+}
+
+void GltfScene::cull(const fgl::Mat4 & viewProjection, fgl::JobSystem & jobs)
+{
+	FGL_TRACE_SCOPE("GltfScene::cull");
+
+	if (culling_)
+	{
+		bvh_.refit();
+		bvh_.cull(fgl::Frustum(fgl::elements(viewProjection)), visible_, jobs);
+		std::sort(visible_.begin(), visible_.end());
+	}
+	else
+	{
+		visible_.resize(draws_.size());
+		std::iota(visible_.begin(), visible_.end(), 0u);
+	}
+
+	// A still camera keeps the instance buffer as it is.
+	if (visible_ == uploadedVisible_)
+	{
+		return;
+	}
+	uploadedVisible_ = visible_;
+	jointsDirty_ = jointsDirty_ || !skins_.empty();
+
+	visibleBatches_.clear();
+	std::vector<GLfloat> matrices;
+	matrices.reserve(visible_.size() * 16);
+	for (size_t i = 0; i < visible_.size(); ++i)
+	{
+		const auto instance = visible_[i];
+		const auto mesh = draws_[instance].mesh;
+		if (visibleBatches_.empty() || visibleBatches_.back().mesh != mesh)
+		{
+			visibleBatches_.push_back({mesh, i, 0});
+		}
+		++visibleBatches_.back().instances;
+
+		const auto * world = instanceMatrices_.data() + size_t{instance} * 16;
+		matrices.insert(matrices.end(), world, world + 16);
+	}
+
+	// Orphan the previous storage so the driver never waits for pending draws.
+	instanceBuffer_->bind();
+	instanceBuffer_->allocate(matrices.data(), static_cast<int>(matrices.size() * sizeof(GLfloat)));
+	instanceBuffer_->release();
+}
+
+void GltfScene::enableInstanceAttributes()
+{
+	// Requires the VAO to be bound, bindInstances() points it at a batch.
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		glEnableVertexAttribArray(g_model_location + column);
+		glVertexAttribDivisor(g_model_location + column, 1);
+	}
+}
+
+void GltfScene::bindInstances(const size_t firstInstance)
+{
+	// No base instance in GL 3.3, the batch offset goes into the attribute pointers instead.
+	constexpr auto stride = static_cast<GLsizei>(16 * sizeof(GLfloat));
+	const auto offset = firstInstance * 16 * sizeof(GLfloat);
+
+	instanceBuffer_->bind();
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		glVertexAttribPointer(g_model_location + column, 4, GL_FLOAT, GL_FALSE, stride,
+							  reinterpret_cast<const void *>(offset + column * 4 * sizeof(GLfloat)));
+	}
+	instanceBuffer_->release();
+}
+
+int GltfScene::validTexture(const int index) const noexcept
+{
+	return index >= 0 && static_cast<size_t>(index) < textures_.size() ? index : -1;
+}
+
+QOpenGLBuffer * GltfScene::uploadBufferView(const GltfAsset & asset, const int index)
+{
+	if (index < 0 || static_cast<size_t>(index) >= buffers_.size())
+	{
+		return nullptr;
+	}
+
+	auto & buffer = buffers_[static_cast<size_t>(index)];
+	if (!buffer)
+	{
+		// In mapped mode the bytes come straight from the file mapping.
+		const auto bytes = asset.bufferView(index);
+		if (bytes.empty())
+		{
+			return nullptr;
+		}
+
+		buffer = std::make_unique<QOpenGLBuffer>(QOpenGLBuffer::Type::VertexBuffer);
+		buffer->create();
+		buffer->bind();
+		buffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+		buffer->allocate(bytes.data(), static_cast<int>(bytes.size()));
+		buffer->release();
+		uploadedBytes_ += bytes.size();
+	}
+	return buffer.get();
+}
+
+bool GltfScene::bindAttribute(const GltfAsset & asset, const tinygltf::Primitive & primitive, const char * name,
+							  const GLuint location, const bool integer)
+{
+	const auto & model = asset.model();
+	const auto it = primitive.attributes.find(name);
+	if (it == primitive.attributes.end() || it->second < 0 || static_cast<size_t>(it->second) >= model.accessors.size())
+	{
+		return false;
+	}
+
+	const auto & accessor = model.accessors[static_cast<size_t>(it->second)];
+	auto * buffer = uploadBufferView(asset, accessor.bufferView);
+	if (!buffer)
+	{
+		return false;
+	}
+
+	const auto stride = accessor.ByteStride(model.bufferViews[static_cast<size_t>(accessor.bufferView)]);
+	if (stride <= 0)
+	{
+		return false;
+	}
+
+	buffer->bind();
+	glEnableVertexAttribArray(location);
+	const auto size = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+	if (integer)
+	{
+		glVertexAttribIPointer(location, size, static_cast<GLenum>(accessor.componentType), stride,
+							   reinterpret_cast<const void *>(accessor.byteOffset));
+	}
+	else
+	{
+		glVertexAttribPointer(location, size, static_cast<GLenum>(accessor.componentType),
+							  accessor.normalized ? GL_TRUE : GL_FALSE, stride, reinterpret_cast<const void *>(accessor.byteOffset));
+	}
+	buffer->release();
+	return true;
+}
+
+void GltfScene::decodeTarget(const GltfAsset & asset, const int accessor, const std::span<float> out) const
+{
+	std::fill(out.begin(), out.end(), 0.0f);
+
+	const auto stream = asset.attribute(accessor);
+	blender_.blend(stream, {}, {}, out);
+
+	// Sparse values replace the dense ones.
+	const auto sparse = asset.sparse(accessor);
+	if (sparse.indices.empty() || stream.components == 0)
+	{
+		return;
+	}
+
+	std::vector<float> values(sparse.values.count * sparse.values.components);
+	blender_.blend(sparse.values, {}, {}, values);
+	for (size_t i = 0; i < sparse.indices.size(); ++i)
+	{
+		const auto index = static_cast<size_t>(sparse.indices[i]) * stream.components;
+		if (index + stream.components <= out.size())
+		{
+			std::copy_n(values.data() + i * stream.components, stream.components, out.data() + index);
+		}
+	}
+}
+
+std::optional<fgl::SparseTarget> GltfScene::sparseTarget(const GltfAsset & asset, const int accessor,
+														std::vector<float> & resolved) const
+{
+	const auto stream = asset.attribute(accessor);
+	auto sparse = asset.sparse(accessor);
+	if (sparse.indices.empty())
+	{
+		return blender_.compact(stream, stream.count / g_sparse_ratio);
+	}
+
+	// Sparse accessors without a buffer view already are (index, delta) pairs.
+	if (!stream.data)
+	{
+		fgl::SparseTarget target;
+		target.components = sparse.values.components;
+		target.indices = std::move(sparse.indices);
+		target.deltas.resize(target.indices.size() * target.components);
+		blender_.blend(sparse.values, {}, {}, target.deltas);
+		return target;
+	}
+
+	// Substitutions over dense data are resolved once, the blend then only sees the result.
+	resolved.resize(stream.count * stream.components);
+	decodeTarget(asset, accessor, resolved);
+	const fgl::AttributeStream decoded{reinterpret_cast<const std::byte *>(resolved.data()), stream.count,
+									   stream.components * sizeof(float), stream.components};
+	return blender_.compact(decoded, stream.count / g_sparse_ratio);
+}
+
+auto GltfScene::createMorph(const GltfAsset & asset, const tinygltf::Primitive & primitive) -> std::unique_ptr<CpuMorph>
+{
+	// Only positions are morphed since the shader does not consume normals or tangents.
+	const auto base = primitive.attributes.find("POSITION");
+	if (primitive.targets.empty() || base == primitive.attributes.end())
+	{
+		return nullptr;
+	}
+
+	auto morph = std::make_unique<CpuMorph>();
+	morph->base = asset.attribute(base->second);
+	if (!morph->base.data || morph->base.components != 3)
+	{
+		return nullptr;
+	}
+
+	for (const auto & target: primitive.targets)
+	{
+		const auto delta = target.find("POSITION");
+		const auto accessor = delta != target.end() ? delta->second : -1;
+		std::vector<float> resolved;
+		if (auto sparse = sparseTarget(asset, accessor, resolved))
+		{
+			morph->targets.emplace_back();
+			morph->sparseTargets.push_back(std::move(*sparse));
+		}
+		else if (!resolved.empty())
+		{
+			// Dense after all, blended from the resolved values.
+			const auto components = asset.attribute(accessor).components;
+			morph->targets.push_back({reinterpret_cast<const std::byte *>(resolved.data()), resolved.size() / components,
+									  components * sizeof(float), components});
+			morph->sparseTargets.emplace_back();
+			morph->resolvedTargets.push_back(std::move(resolved));
+		}
+		else
+		{
+			morph->targets.push_back(asset.attribute(accessor));
+			morph->sparseTargets.emplace_back();
+		}
+	}
+
+	morph->blended.resize(morph->base.count * 3);
+	blender_.blend(morph->base, {}, {}, morph->blended);
+
+	morph->buffer = std::make_unique<QOpenGLBuffer>(QOpenGLBuffer::Type::VertexBuffer);
+	morph->buffer->create();
+	morph->buffer->bind();
+	morph->buffer->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	morph->buffer->allocate(morph->blended.data(), static_cast<int>(morph->blended.size() * sizeof(float)));
+	morph->buffer->release();
+	uploadedBytes_ += morph->blended.size() * sizeof(float);
+	return morph;
+}
+
+auto GltfScene::createGpuMorph(const GltfAsset & asset, const tinygltf::Primitive & primitive) -> std::unique_ptr<GpuMorph>
+{
+	const auto base = primitive.attributes.find("POSITION");
+	if (primitive.targets.empty() || base == primitive.attributes.end())
+	{
+		return nullptr;
+	}
+
+	const auto vertices = asset.attribute(base->second).count;
+	const auto texels = vertices * primitive.targets.size();
+
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	const auto width = std::min(texels, static_cast<size_t>(maxSize));
+	const auto height = (texels + width - 1) / width;
+	if (vertices == 0 || height > static_cast<size_t>(maxSize))
+	{
+		return nullptr;
+	}
+
+	// Decode every target once into RGBA32F texels.
+	std::vector<float> texelData(width * height * 4, 0.0f);
+	std::vector<float> delta(vertices * 3);
+	for (size_t target = 0; target < primitive.targets.size(); ++target)
+	{
+		const auto it = primitive.targets[target].find("POSITION");
+		const auto accessor = it != primitive.targets[target].end() ? it->second : -1;
+		const auto stream = asset.attribute(accessor);
+		if (stream.components != 3 || stream.count < vertices)
+		{
+			continue;
+		}
+
+		decodeTarget(asset, accessor, delta);
+		for (size_t vertex = 0; vertex < vertices; ++vertex)
+		{
+			std::copy_n(delta.data() + vertex * 3, 3, texelData.data() + (target * vertices + vertex) * 4);
+		}
+	}
+
+	auto morph = std::make_unique<GpuMorph>();
+	morph->vertices = static_cast<GLint>(vertices);
+	morph->deltas = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2D);
+	morph->deltas->setFormat(QOpenGLTexture::RGBA32F);
+	morph->deltas->setSize(static_cast<int>(width), static_cast<int>(height));
+	morph->deltas->setMipLevels(1);
+	morph->deltas->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::Float32);
+	morph->deltas->setData(QOpenGLTexture::RGBA, QOpenGLTexture::Float32, texelData.data());
+	morph->deltas->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+	uploadedBytes_ += texelData.size() * sizeof(float);
+	return morph;
+}
+
+void GltfScene::prepareMeshes(const GltfAsset & asset)
+{
+	const auto & model = asset.model();
+	meshes_.resize(model.meshes.size());
+	weights_.resize(model.meshes.size());
+	activeTargets_.resize(model.meshes.size());
+	morphsDirty_.assign(model.meshes.size(), true);
+	restBounds_.resize(model.meshes.size());
+	targetBounds_.resize(model.meshes.size());
+	jointStrides_.assign(model.meshes.size(), 0);
+
+	for (size_t i = 0; i < model.meshes.size(); ++i)
+	{
+		const auto & mesh = model.meshes[i];
+		for (const auto & source: mesh.primitives)
+		{
+			weights_[i].resize(std::max(weights_[i].size(), source.targets.size()));
+			targetBounds_[i].resize(weights_[i].size(), fgl::Aabb{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}});
+
+			const auto position = source.attributes.find("POSITION");
+			if (position != source.attributes.end())
+			{
+				restBounds_[i].grow(accessorBounds(model, position->second));
+			}
+			for (size_t target = 0; target < source.targets.size(); ++target)
+			{
+				const auto delta = source.targets[target].find("POSITION");
+				if (delta != source.targets[target].end())
+				{
+					targetBounds_[i][target].grow(accessorBounds(model, delta->second));
+				}
+			}
+		}
+		for (size_t target = 0; target < std::min(weights_[i].size(), mesh.weights.size()); ++target)
+		{
+			weights_[i][target] = static_cast<float>(mesh.weights[target]);
+		}
+	}
+
+	// Draws are not known yet, this only fills meshBounds_.
+	meshBounds_.resize(model.meshes.size());
+	for (size_t i = 0; i < model.meshes.size(); ++i)
+	{
+		updateBounds(i);
+	}
+}
+
+void GltfScene::createMesh(const GltfAsset & asset, const size_t i)
+{
+	FGL_TRACE_SCOPE("GltfScene::createMesh");
+
+	const auto & model = asset.model();
+	const auto & mesh = model.meshes[i];
+
+	for (const auto & source: mesh.primitives)
+	{
+		Primitive primitive;
+		primitive.mode = static_cast<GLenum>(source.mode >= 0 ? source.mode : TINYGLTF_MODE_TRIANGLES);
+
+		primitive.vao = std::make_unique<QOpenGLVertexArrayObject>();
+		primitive.vao->create();
+		primitive.vao->bind();
+		enableInstanceAttributes();
+
+		const auto hasPositions = bindAttribute(asset, source, "POSITION", g_position_location);
+		if (hasPositions && morphMode_ == MorphMode::Gpu)
+		{
+			primitive.gpuMorph = createGpuMorph(asset, source);
+		}
+		if (hasPositions && !primitive.gpuMorph)
+		{
+			primitive.morph = createMorph(asset, source);
+		}
+		if (primitive.morph)
+		{
+			// Positions come from the blended stream.
+			primitive.morph->buffer->bind();
+			glVertexAttribPointer(g_position_location, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+			primitive.morph->buffer->release();
+		}
+		primitive.hasColors = bindAttribute(asset, source, "COLOR_0", g_color_location);
+		bindAttribute(asset, source, "TEXCOORD_0", g_texcoord_location);
+		if (jointStrides_[i] > 0)
+		{
+			primitive.skinned = bindAttribute(asset, source, "JOINTS_0", g_joints_location, true)
+				&& bindAttribute(asset, source, "WEIGHTS_0", g_weights_location);
+			if (!primitive.skinned)
+			{
+				glDisableVertexAttribArray(g_joints_location);
+			}
+		}
+
+		if (source.indices >= 0)
+		{
+			const auto & accessor = model.accessors[static_cast<size_t>(source.indices)];
+			if (auto * buffer = uploadBufferView(asset, accessor.bufferView))
+			{
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->bufferId());
+				primitive.indexed = true;
+				primitive.indexType = static_cast<GLenum>(accessor.componentType);
+				primitive.indexOffset = accessor.byteOffset;
+				primitive.count = static_cast<GLsizei>(accessor.count);
+			}
+		}
+		else if (hasPositions)
+		{
+			primitive.count = static_cast<GLsizei>(model.accessors[static_cast<size_t>(source.attributes.at("POSITION"))].count);
+		}
+
+		primitive.vao->release();
+
+		if (source.material >= 0 && static_cast<size_t>(source.material) < model.materials.size())
+		{
+			const auto & pbr = model.materials[static_cast<size_t>(source.material)].pbrMetallicRoughness;
+			if (pbr.baseColorFactor.size() >= 3)
+			{
+				primitive.color = QVector3D(static_cast<float>(pbr.baseColorFactor[0]),
+											static_cast<float>(pbr.baseColorFactor[1]),
+											static_cast<float>(pbr.baseColorFactor[2]));
+			}
+			primitive.texture = validTexture(pbr.baseColorTexture.index);
+		}
+		primitive.features = (primitive.hasColors ? ShaderVariants::VertexColor : 0u)
+			| (primitive.texture >= 0 ? ShaderVariants::Texture : 0u) | (primitive.skinned ? ShaderVariants::Skin : 0u);
+
+		if (!hasPositions || primitive.count == 0)
+		{
+			continue;
+		}
+		meshes_[i].push_back(std::move(primitive));
+	}
+
+	// A primitive whose joints did not bind would be drawn rigid inside skinned instances.
+	if (jointStrides_[i] > 0 && std::any_of(meshes_[i].begin(), meshes_[i].end(), [](const Primitive & primitive) {
+			return !primitive.skinned;
+		}))
+	{
+		qWarning() << "Mesh" << i << "has primitives without usable joints, drawing it rigid";
+		drawRigid(i);
+	}
+
+	// Blend the current weights into the new primitives.
+	morphsDirty_[i] = true;
+}
+
+void GltfScene::createTexture(const GltfAsset & asset, const size_t i)
+{
+	const auto & model = asset.model();
+	const auto source = model.textures[i].source;
+	if (source < 0 || static_cast<size_t>(source) >= model.images.size())
+	{
+		return;
+	}
+
+	const auto & image = model.images[static_cast<size_t>(source)];
+	if (image.image.empty() || image.bits != 8 || (image.component != 3 && image.component != 4))
+	{
+		return;
+	}
+
+	FGL_TRACE_SCOPE("GltfScene::createTexture");
+
+	const QImage view(image.image.data(), image.width, image.height, image.width * image.component,
+					  image.component == 4 ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+
+	auto texture = std::make_unique<QOpenGLTexture>(view);
+	texture->setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
+	texture->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
+	textures_[i] = std::move(texture);
+	uploadedBytes_ += image.image.size();
+}
+
+void GltfScene::createCachedGeometry(const SceneCache & cache)
+{
+	FGL_TRACE_SCOPE("GltfScene::createCachedGeometry");
+
+	// One vertex and one index buffer straight from the mapping, primitives are ranges of them.
+	const auto vertices = cache.vertices();
+	const auto indices = std::as_bytes(cache.indices());
+
+	auto & vertexBuffer = buffers_.emplace_back(std::make_unique<QOpenGLBuffer>(QOpenGLBuffer::Type::VertexBuffer));
+	vertexBuffer->create();
+	vertexBuffer->bind();
+	vertexBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+	vertexBuffer->allocate(vertices.data(), static_cast<int>(vertices.size()));
+	vertexBuffer->release();
+
+	auto & indexBuffer = buffers_.emplace_back(std::make_unique<QOpenGLBuffer>(QOpenGLBuffer::Type::IndexBuffer));
+	indexBuffer->create();
+	indexBuffer->bind();
+	indexBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+	indexBuffer->allocate(indices.data(), static_cast<int>(indices.size()));
+	indexBuffer->release();
+	uploadedBytes_ += vertices.size() + indices.size();
+
+	const auto quantized = cache.vertexFormat() == SceneCache::VertexFormat::Quantized;
+	const auto stride = static_cast<GLsizei>(SceneCache::vertexSize(cache.vertexFormat()));
+	for (const auto & source: cache.primitives())
+	{
+		Primitive primitive;
+		primitive.mode = static_cast<GLenum>(source.mode);
+		primitive.texture = validTexture(source.texture);
+		primitive.hasColors = true;
+		primitive.quantized = quantized;
+		primitive.features = ShaderVariants::VertexColor | (primitive.texture >= 0 ? ShaderVariants::Texture : 0u)
+			| (quantized ? ShaderVariants::Quantized : 0u);
+		primitive.positionOffset = QVector3D(source.positionOffset[0], source.positionOffset[1], source.positionOffset[2]);
+		primitive.positionScale = QVector3D(source.positionScale[0], source.positionScale[1], source.positionScale[2]);
+
+		primitive.vao = std::make_unique<QOpenGLVertexArrayObject>();
+		primitive.vao->create();
+		primitive.vao->bind();
+		enableInstanceAttributes();
+
+		const auto offset = size_t{source.firstVertex} * static_cast<size_t>(stride);
+		const auto attribute = [&](const GLuint location, const GLint size, const GLenum type, const bool normalized,
+								   const size_t at) {
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, size, type, normalized ? GL_TRUE : GL_FALSE, stride,
+								  reinterpret_cast<const void *>(offset + at));
+		};
+
+		vertexBuffer->bind();
+		if (quantized)
+		{
+			attribute(g_position_location, 3, GL_UNSIGNED_SHORT, true, 0);
+			attribute(g_color_location, 4, GL_UNSIGNED_BYTE, true, 4 * sizeof(uint16_t));
+			attribute(g_texcoord_location, 2, GL_HALF_FLOAT, false, 4 * sizeof(uint16_t) + 4);
+		}
+		else
+		{
+			attribute(g_position_location, 3, GL_FLOAT, false, 0);
+			attribute(g_color_location, 3, GL_FLOAT, false, 3 * sizeof(float));
+			attribute(g_texcoord_location, 2, GL_FLOAT, false, 6 * sizeof(float));
+		}
+		vertexBuffer->release();
+
+		if (source.indexCount > 0)
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->bufferId());
+			primitive.indexed = true;
+			primitive.indexType = GL_UNSIGNED_INT;
+			primitive.indexOffset = size_t{source.firstIndex} * sizeof(uint32_t);
+			primitive.count = static_cast<GLsizei>(source.indexCount);
+		}
+		else
+		{
+			primitive.count = static_cast<GLsizei>(source.vertexCount);
+		}
+
+		primitive.vao->release();
+		meshes_[source.mesh].push_back(std::move(primitive));
+	}
+
+	nextMesh_ = meshes_.size();
+}
+
+void GltfScene::createCachedTexture(const SceneCache & cache, const size_t i)
+{
+	const auto & source = cache.textures()[i];
+	if (source.levels == 0)
+	{
+		return;
+	}
+
+	FGL_TRACE_SCOPE("GltfScene::createCachedTexture");
+
+	// Mips come with the cache, nothing is generated at load time.
+	auto texture = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2D);
+	texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+	texture->setSize(static_cast<int>(source.width), static_cast<int>(source.height));
+	texture->setMipLevels(static_cast<int>(source.levels));
+	texture->setAutoMipMapGenerationEnabled(false);
+	texture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+	for (uint32_t level = 0; level < source.levels; ++level)
+	{
+		const auto pixels = cache.level(source, level);
+		texture->setData(static_cast<int>(level), QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, pixels.data());
+		uploadedBytes_ += pixels.size();
+	}
+	texture->setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
+	texture->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
+	textures_[i] = std::move(texture);
+}
+
+void GltfScene::collectDraws(const tinygltf::Model & model, const int node, const uint32_t parent)
+{
+	if (node < 0 || static_cast<size_t>(node) >= model.nodes.size())
+	{
+		return;
+	}
+
+	// Nodes with a matrix can not be animated and keep it.
+	const auto & source = model.nodes[static_cast<size_t>(node)];
+	uint32_t graphNode = fgl::SceneGraph::g_none;
+	if (source.matrix.size() == 16)
+	{
+		std::array<float, 16> matrix;
+		std::transform(source.matrix.begin(), source.matrix.end(), matrix.begin(), [](const double value) {
+			return static_cast<float>(value);
+		});
+		graphNode = graph_.add(parent, matrix);
+	}
+	else
+	{
+		fgl::SceneGraph::Transform transform;
+		const auto copy = [](const std::vector<double> & values, auto & target) {
+			if (values.size() == target.size())
+			{
+				std::transform(values.begin(), values.end(), target.begin(), [](const double value) {
+					return static_cast<float>(value);
+				});
+			}
+		};
+		copy(source.translation, transform.translation);
+		copy(source.rotation, transform.rotation);
+		copy(source.scale, transform.scale);
+		graphNode = graph_.add(parent, transform);
+	}
+	graphNodes_[static_cast<size_t>(node)] = graphNode;
+
+	if (source.mesh >= 0 && static_cast<size_t>(source.mesh) < model.meshes.size())
+	{
+		// Skinned vertices are placed by their joints, the node's own transform does not apply.
+		const auto skin = source.skin >= 0 && static_cast<size_t>(source.skin) < model.skins.size()
+				&& !model.skins[static_cast<size_t>(source.skin)].joints.empty()
+			? source.skin
+			: -1;
+		const auto world = skin >= 0 ? fgl::Mat4(1.0f) : fgl::fromElements(graph_.world(graphNode));
+		draws_.push_back({static_cast<size_t>(source.mesh), world, graphNode, skin});
+		// Morph weights are kept per mesh, so a node's own weights apply to every instance of its mesh.
+		if (!source.weights.empty())
+		{
+			std::vector<float> weights(source.weights.size());
+			std::transform(source.weights.begin(), source.weights.end(), weights.begin(), [](const double value) {
+				return static_cast<float>(value);
+			});
+			setMorphWeights(static_cast<size_t>(source.mesh), weights);
+			updateBounds(static_cast<size_t>(source.mesh));
+		}
+		for (const auto & primitive: model.meshes[static_cast<size_t>(source.mesh)].primitives)
+		{
+			growBounds(model, primitive, world);
+		}
+	}
+
+	for (const auto child: source.children)
+	{
+		collectDraws(model, child, graphNode);
+	}
+}
+
+void GltfScene::growBounds(const tinygltf::Model & model, const tinygltf::Primitive & primitive, const fgl::Mat4 & world)
+{
+	const auto it = primitive.attributes.find("POSITION");
+	if (it == primitive.attributes.end() || it->second < 0 || static_cast<size_t>(it->second) >= model.accessors.size())
+	{
+		return;
+	}
+
+	const auto & accessor = model.accessors[static_cast<size_t>(it->second)];
+	if (accessor.minValues.size() != 3 || accessor.maxValues.size() != 3)
+	{
+		return;
+	}
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		const auto & x = corner & 1 ? accessor.maxValues : accessor.minValues;
+		const auto & y = corner & 2 ? accessor.maxValues : accessor.minValues;
+		const auto & z = corner & 4 ? accessor.maxValues : accessor.minValues;
+		const auto point = fgl::transformPoint(world, {static_cast<float>(x[0]), static_cast<float>(y[1]), static_cast<float>(z[2])});
+
+		boundsMin_ = QVector3D(std::min(boundsMin_.x(), point.x), std::min(boundsMin_.y(), point.y), std::min(boundsMin_.z(), point.z));
+		boundsMax_ = QVector3D(std::max(boundsMax_.x(), point.x), std::max(boundsMax_.y(), point.y), std::max(boundsMax_.z(), point.z));
+	}
+}
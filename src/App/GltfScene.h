@@ -0,0 +1,303 @@
+#pragma once
+
+#include "GltfAsset.h"
+#include "SceneCache.h"
+#include "ShaderVariants.h"
+
+#include <Base/Bvh.hpp>
+#include <Base/JobSystem.hpp>
+#include <Base/Math.hpp>
+#include <Base/MorphBlender.hpp>
+#include <Base/RenderQueue.hpp>
+#include <Base/SceneGraph.hpp>
+#include <Base/Skinning.hpp>
+#include <Base/UniformRing.hpp>
+
+#include <QOpenGLBuffer>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+#include <QVector3D>
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// GPU side of a GltfAsset: buffer views, textures and the draw list of the default scene.
+// Nodes sharing a mesh are drawn together, one instanced draw call per primitive of every mesh.
+// Nodes outside the view frustum are culled with a BVH over their world bounds, the remaining draw
+// calls are sorted by state.
+// Skinned meshes are skinned in the vertex shader. Joint matrices are computed on the CPU whenever
+// transforms change and the visible instances' go into a float texture, so skins have no joint limit.
+// The asset must outlive the scene.
+class GltfScene final : protected QOpenGLExtraFunctions
+{
+public:
+	static constexpr GLuint g_position_location = 0;
+	static constexpr GLuint g_color_location = 1;
+	static constexpr GLuint g_texcoord_location = 2;
+	// World matrix per instance, a mat4 taking this and the next three locations.
+	static constexpr GLuint g_model_location = 3;
+	static constexpr GLuint g_joints_location = 7;
+	static constexpr GLuint g_weights_location = 8;
+
+	// Must match MAX_MORPH_TARGETS in diffuse.vs, variants morph with up to as many targets.
+	static constexpr size_t g_max_active_targets = 8;
+	static_assert(g_max_active_targets % 4 == 0, "targets are packed into ivec4s");
+
+	// Binding point of the DrawUniforms block.
+	static constexpr GLuint g_draw_uniforms_binding = 0;
+
+	// std140 layout of the DrawUniforms block in diffuse.vs, written once per draw call and frame.
+	// The defaults draw white without morphing.
+	struct DrawUniforms {
+		std::array<GLfloat, 4> positionOffset{0.0f, 0.0f, 0.0f, 0.0f};
+		std::array<GLfloat, 4> positionScale{1.0f, 1.0f, 1.0f, 0.0f};
+		std::array<GLfloat, 4> baseColor{1.0f, 1.0f, 1.0f, 1.0f};
+		// Active targets and vertices per target.
+		std::array<GLint, 4> morphParams{0, 0, 0, 0};
+		// First joint matrix of the first instance and joints per instance.
+		std::array<GLint, 4> skinParams{0, 0, 0, 0};
+		std::array<GLint, g_max_active_targets> morphTargets{};
+		std::array<GLfloat, g_max_active_targets> morphWeights{};
+	};
+
+	enum class MorphMode
+	{
+		// Blend on the CPU and re-upload positions whenever weights change.
+		Cpu,
+		// Keep all deltas in a texture and blend the top weights in the vertex shader.
+		Gpu,
+	};
+
+	// Require a current context. begin() only prepares the draw list and bounds and leaves meshes and
+	// textures to upload(), loading up front just uploads until it is done.
+	void begin(const GltfAsset & asset, MorphMode morphMode);
+	// Same from a scene cache, which must outlive the scene. All geometry is one upload.
+	void begin(const SceneCache & cache);
+	void destroy();
+
+	// Uploads pending meshes, then textures, until `budget` bytes went to the GPU; at least one item
+	// per call. True once everything is uploaded.
+	bool upload(size_t budget);
+	[[nodiscard]] bool uploaded() const noexcept
+	{
+		return (!asset_ && !cache_) || (nextMesh_ == meshes_.size() && nextTexture_ == textures_.size());
+	}
+	[[nodiscard]] size_t uploadedBytes() const noexcept { return uploadedBytes_; }
+
+	// Culls, writes the uniforms of all draw calls into a frame of `uniforms`, then draws every primitive
+	// with the variant of `shaders` for its features. Textures not uploaded yet are drawn with the fallback.
+	// Culling and sort keys are computed as `jobs`, GL calls stay on the calling thread.
+	void draw(ShaderVariants & shaders, fgl::UniformRing & uniforms, const fgl::Mat4 & viewProjection,
+			  QOpenGLTexture & fallbackTexture, fgl::JobSystem & jobs);
+	// Nodes with a mesh, and the draw calls draw() issues for them once everything is uploaded.
+	[[nodiscard]] size_t instanceCount() const noexcept { return draws_.size(); }
+	[[nodiscard]] size_t drawCallCount() const noexcept;
+	// Nodes that passed culling in the last draw().
+	[[nodiscard]] size_t visibleCount() const noexcept { return visible_.size(); }
+	void setCulling(bool enabled) noexcept { culling_ = enabled; }
+	// State changes of the last draw().
+	[[nodiscard]] const fgl::SubmitStats & submitStats() const noexcept { return submitStats_; }
+
+	// Weights take effect on the next updateMorphs().
+	[[nodiscard]] size_t meshCount() const noexcept { return meshes_.size(); }
+	[[nodiscard]] size_t morphTargetCount(size_t mesh) const noexcept { return weights_[mesh].size(); }
+	void setMorphWeights(size_t mesh, std::span<const float> weights);
+	// CPU morphing blends the primitives and their blocks of vertices as `jobs`.
+	void updateMorphs(fgl::JobSystem & jobs);
+
+	// Nodes of the asset, none for a scene cache. Nodes outside the default scene are ignored. Transforms
+	// take effect on the next updateTransforms(), which only recomputes what is below changed nodes.
+	[[nodiscard]] size_t nodeCount() const noexcept { return graphNodes_.size(); }
+	void setNodeTranslation(size_t node, std::span<const float, 3> translation);
+	// Quaternion x, y, z, w.
+	void setNodeRotation(size_t node, std::span<const float, 4> rotation);
+	void setNodeScale(size_t node, std::span<const float, 3> scale);
+	// Joint matrices of moved skins are computed as `jobs`.
+	void updateTransforms(fgl::JobSystem & jobs);
+	[[nodiscard]] size_t skinCount() const noexcept { return skins_.size(); }
+
+	[[nodiscard]] bool empty() const noexcept { return draws_.empty(); }
+	[[nodiscard]] QVector3D boundsMin() const noexcept { return boundsMin_; }
+	[[nodiscard]] QVector3D boundsMax() const noexcept { return boundsMax_; }
+
+private:
+	struct CpuMorph {
+		fgl::AttributeStream base;
+		// Per target either a dense stream or a sparse one, the other is left empty.
+		std::vector<fgl::AttributeStream> targets;
+		std::vector<fgl::SparseTarget> sparseTargets;
+		// Values of sparse accessors over dense data that moved too many vertices to stay sparse, dense
+		// streams point into them. Moving the vectors keeps their storage.
+		std::vector<std::vector<float>> resolvedTargets;
+		std::vector<float> blended;
+		std::unique_ptr<QOpenGLBuffer> buffer;
+	};
+
+	struct GpuMorph {
+		std::unique_ptr<QOpenGLTexture> deltas;
+		GLint vertices = 0;
+	};
+
+	// Largest weights of a mesh, the only per-frame data of GPU morphing.
+	struct ActiveTargets {
+		std::array<GLint, g_max_active_targets> targets{};
+		std::array<GLfloat, g_max_active_targets> weights{};
+		GLint count = 0;
+	};
+
+	struct Primitive {
+		std::unique_ptr<QOpenGLVertexArrayObject> vao;
+		std::unique_ptr<CpuMorph> morph;
+		std::unique_ptr<GpuMorph> gpuMorph;
+		GLenum mode = GL_TRIANGLES;
+		GLsizei count = 0;
+		bool indexed = false;
+		GLenum indexType = GL_UNSIGNED_INT;
+		size_t indexOffset = 0;
+		int texture = -1;
+		QVector3D color{1.0f, 1.0f, 1.0f};
+		bool hasColors = false;
+		// Quantized positions are dequantized with these in the vertex shader.
+		bool quantized = false;
+		QVector3D positionOffset;
+		QVector3D positionScale{1.0f, 1.0f, 1.0f};
+		bool skinned = false;
+		// ShaderVariants features except morphing, which depends on the active targets.
+		uint32_t features = 0;
+	};
+
+	struct Draw {
+		size_t mesh = 0;
+		fgl::Mat4 world{1.0f};
+		// Scene graph node, none for a scene cache.
+		uint32_t node = fgl::SceneGraph::g_none;
+		// Skinned draws have an identity world matrix.
+		int skin = -1;
+	};
+
+	// Draws of one mesh, a range of the instance buffer.
+	struct Batch {
+		size_t mesh = 0;
+		size_t firstInstance = 0;
+		GLsizei instances = 0;
+		// Of visible batches, the joint matrix of the first instance.
+		GLint firstJoint = 0;
+	};
+
+	struct Skin {
+		// Scene graph nodes of the joints, none for ones outside the default scene.
+		std::vector<uint32_t> joints;
+		// World matrix of every joint, and their skin matrices.
+		std::vector<float> worlds;
+		std::vector<float> matrices;
+		// Recomputed by the last updateSkins().
+		bool changed = false;
+	};
+
+	// A primitive of a visible batch.
+	struct Command {
+		size_t batch = 0;
+		size_t primitive = 0;
+		const ShaderVariants::Variant * variant = nullptr;
+	};
+
+	void createInstances();
+	void updateBounds(size_t mesh);
+	[[nodiscard]] fgl::Aabb drawBounds(size_t draw) const;
+	void createSkins(const GltfAsset & asset);
+	void assignSkins(const tinygltf::Model & model);
+	// Draws the mesh with node worlds and without joints from now on.
+	void drawRigid(size_t mesh);
+	// Recomputes the skins with a moved joint, or all of them, one job per skin if `jobs` is given. True if
+	// any was.
+	bool updateSkins(bool all, fgl::JobSystem * jobs);
+	// False if the joints do not fit into a texture, skinned meshes are drawn rigid then.
+	bool uploadJoints();
+	void cull(const fgl::Mat4 & viewProjection, fgl::JobSystem & jobs);
+	void sortDraws(ShaderVariants & shaders, const fgl::Mat4 & viewProjection, fgl::JobSystem & jobs);
+	void enableInstanceAttributes();
+	void bindInstances(size_t firstInstance);
+	// The index if it names a texture slot, else -1 so the primitive is drawn untextured.
+	[[nodiscard]] int validTexture(int index) const noexcept;
+	QOpenGLBuffer * uploadBufferView(const GltfAsset & asset, int index);
+	bool bindAttribute(const GltfAsset & asset, const tinygltf::Primitive & primitive, const char * name, GLuint location,
+					   bool integer = false);
+	void decodeTarget(const GltfAsset & asset, int accessor, std::span<float> out) const;
+	// Null if the target moves more than 1/g_sparse_ratio of the vertices. Sparse accessors over dense data
+	// are resolved into `resolved` first, a dense stream has to point there then.
+	std::optional<fgl::SparseTarget> sparseTarget(const GltfAsset & asset, int accessor, std::vector<float> & resolved) const;
+	std::unique_ptr<CpuMorph> createMorph(const GltfAsset & asset, const tinygltf::Primitive & primitive);
+	std::unique_ptr<GpuMorph> createGpuMorph(const GltfAsset & asset, const tinygltf::Primitive & primitive);
+	void selectActiveTargets(size_t mesh);
+	void prepareMeshes(const GltfAsset & asset);
+	void createMesh(const GltfAsset & asset, size_t i);
+	void createTexture(const GltfAsset & asset, size_t i);
+	void createCachedGeometry(const SceneCache & cache);
+	void createCachedTexture(const SceneCache & cache, size_t i);
+	void collectDraws(const tinygltf::Model & model, int node, uint32_t parent);
+	void growBounds(const tinygltf::Model & model, const tinygltf::Primitive & primitive, const fgl::Mat4 & world);
+
+private:
+	const GltfAsset * asset_ = nullptr;
+	const SceneCache * cache_ = nullptr;
+	size_t nextMesh_ = 0;
+	size_t nextTexture_ = 0;
+	size_t uploadedBytes_ = 0;
+
+	std::vector<std::unique_ptr<QOpenGLBuffer>> buffers_;
+	std::vector<std::unique_ptr<QOpenGLTexture>> textures_;
+	std::vector<std::vector<Primitive>> meshes_;
+	std::vector<Draw> draws_;
+	// Nodes of the default scene, and the graph node of every asset node.
+	fgl::SceneGraph graph_;
+	std::vector<uint32_t> graphNodes_;
+	// Draw of every graph node, none for nodes without a mesh.
+	std::vector<uint32_t> nodeDraws_;
+	std::vector<Batch> batches_;
+	// Draw calls of the current frame in submission order, with their ring offsets.
+	std::vector<Command> commands_;
+	fgl::RenderQueue queue_;
+	std::vector<size_t> uniformOffsets_;
+	fgl::SubmitStats submitStats_;
+
+	// World matrices of all draws, the instance buffer holds those of the visible ones.
+	std::vector<GLfloat> instanceMatrices_;
+	std::unique_ptr<QOpenGLBuffer> instanceBuffer_;
+	std::vector<Batch> visibleBatches_;
+	// Sort depth of every visible batch.
+	std::vector<float> batchDepths_;
+	std::vector<uint32_t> visible_;
+	std::vector<uint32_t> uploadedVisible_;
+
+	// Object-space bounds per mesh at rest, of every morph target's deltas and with the current weights.
+	std::vector<fgl::Aabb> restBounds_;
+	std::vector<std::vector<fgl::Aabb>> targetBounds_;
+	std::vector<fgl::Aabb> meshBounds_;
+	fgl::Bvh bvh_;
+	bool culling_ = true;
+
+	MorphMode morphMode_ = MorphMode::Gpu;
+	fgl::MorphBlender blender_;
+	std::vector<std::vector<float>> weights_;
+	std::vector<ActiveTargets> activeTargets_;
+	std::vector<size_t> targetOrder_;
+	std::vector<bool> morphsDirty_;
+	std::vector<std::pair<CpuMorph *, size_t>> blendedMorphs_;
+
+	fgl::Skinning skinning_;
+	std::vector<Skin> skins_;
+	std::vector<size_t> changedSkins_;
+	// Joints per instance of every mesh, 0 for rigid ones.
+	std::vector<size_t> jointStrides_;
+	std::vector<float> jointTexels_;
+	std::unique_ptr<QOpenGLTexture> jointTexture_;
+	bool jointsDirty_ = false;
+
+	QVector3D boundsMin_;
+	QVector3D boundsMax_;
+};
@@ -0,0 +1,185 @@
+#include "ProgramCache.h"
+
+#include <Base/Hash.hpp>
+#include <Base/Trace.hpp>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+constexpr std::array<char, 4> g_magic = {'F', 'G', 'L', 'P'};
+
+struct Header {
+	std::array<char, 4> magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t size;
+};
+
+uint64_t hashString(const QByteArray & bytes, const uint64_t seed)
+{
+	return fgl::hash64(std::as_bytes(std::span(bytes.constData(), static_cast<size_t>(bytes.size()))), seed);
+}
+
+QString pathFor(const uint64_t key)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/programs/"
+		+ QString::number(key, 16).rightJustified(16, '0') + ".fglprogram";
+}
+
+}// namespace
+
+ProgramCache::ProgramCache(const bool enabled) noexcept
+	: enabled_{enabled}
+{
+}
+
+bool ProgramCache::build(QOpenGLShaderProgram & program, const std::span<const Shader> shaders, QString & error)
+{
+	FGL_TRACE_SCOPE("ProgramCache::build");
+
+	initializeOpenGLFunctions();
+
+	if (!program.create())
+	{
+		error = "Failed to create a program";
+		return false;
+	}
+
+	// Drivers without binary formats can not cache programs.
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	const auto cacheable = enabled_ && formats > 0;
+	const auto programKey = cacheable ? key(shaders) : 0;
+	const auto path = cacheable ? pathFor(programKey) : QString();
+
+	// A program linked by glProgramBinary has no shaders, link() only picks up its status.
+	if (cacheable && loadBinary(program.programId(), path, programKey) && program.link())
+	{
+		++hits_;
+		return true;
+	}
+
+	FGL_TRACE_SCOPE("ProgramCache::compile");
+	++misses_;
+	for (const auto & shader: shaders)
+	{
+		if (!program.addShaderFromSourceCode(shader.type, shader.source))
+		{
+			error = program.log();
+			return false;
+		}
+	}
+	if (cacheable)
+	{
+		glProgramParameteri(program.programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	if (!program.link())
+	{
+		error = program.log();
+		return false;
+	}
+
+	QString storeError;
+	if (cacheable && !storeBinary(program.programId(), path, programKey, storeError))
+	{
+		qWarning() << "Failed to cache program:" << storeError;
+	}
+	return true;
+}
+
+uint64_t ProgramCache::key(const std::span<const Shader> shaders)
+{
+	// Binaries are only valid for the driver that produced them.
+	auto hash = uint64_t{g_version};
+	for (const auto name: {GL_VENDOR, GL_RENDERER, GL_VERSION})
+	{
+		hash = hashString(QByteArray(reinterpret_cast<const char *>(glGetString(name))), hash);
+	}
+	for (const auto & shader: shaders)
+	{
+		const auto type = static_cast<uint32_t>(shader.type);
+		hash = fgl::hash64(std::as_bytes(std::span{&type, 1}), hash);
+		hash = hashString(shader.source, hash);
+	}
+	return hash;
+}
+
+bool ProgramCache::loadBinary(const GLuint program, const QString & path, const uint64_t key)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+	const auto bytes = file.readAll();
+
+	Header header{};
+	if (static_cast<size_t>(bytes.size()) < sizeof(header))
+	{
+		return false;
+	}
+	std::memcpy(&header, bytes.constData(), sizeof(header));
+	if (header.magic != g_magic || header.version != g_version || header.key != key
+		|| static_cast<size_t>(bytes.size()) != sizeof(header) + header.size)
+	{
+		return false;
+	}
+
+	// A driver update may reject the binary, then the program is compiled again and the file replaced.
+	glProgramBinary(program, header.format, bytes.constData() + sizeof(header), static_cast<GLsizei>(header.size));
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE;
+}
+
+bool ProgramCache::storeBinary(const GLuint program, const QString & path, const uint64_t key, QString & error)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		error = "The driver returned no binary";
+		return false;
+	}
+
+	Header header{g_magic, g_version, key, 0, 0};
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLsizei size = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &size, &format, binary.data());
+	header.format = format;
+	header.size = static_cast<uint32_t>(size);
+
+	if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+	{
+		error = QString("Failed to create %1").arg(QFileInfo(path).absolutePath());
+		return false;
+	}
+
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		error = QString("Failed to create %1: %2").arg(path, file.errorString());
+		return false;
+	}
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(binary.data(), size);
+	if (!file.commit())
+	{
+		error = QString("Failed to write %1: %2").arg(path, file.errorString());
+		return false;
+	}
+	return true;
+}
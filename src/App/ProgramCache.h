@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QByteArray>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShader>
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+#include <cstdint>
+#include <span>
+
+// Linked program binaries on disk, keyed by a hash of the shader sources and of the driver, so warm
+// starts neither compile nor link. Without a usable binary the program is compiled from source and
+// its binary stored for the next start.
+class ProgramCache final : protected QOpenGLExtraFunctions
+{
+public:
+	// Bump whenever the file layout changes.
+	static constexpr uint32_t g_version = 1;
+
+	struct Shader {
+		QOpenGLShader::ShaderType type;
+		QByteArray source;
+	};
+
+	explicit ProgramCache(bool enabled = true) noexcept;
+
+	// Requires a current context. Links `program` from a binary or from `shaders`, false with the log
+	// in `error` if it fails to compile or link.
+	bool build(QOpenGLShaderProgram & program, std::span<const Shader> shaders, QString & error);
+
+	// Programs that came from a binary and ones compiled from source.
+	[[nodiscard]] size_t hits() const noexcept { return hits_; }
+	[[nodiscard]] size_t misses() const noexcept { return misses_; }
+
+private:
+	[[nodiscard]] uint64_t key(std::span<const Shader> shaders);
+	bool loadBinary(GLuint program, const QString & path, uint64_t key);
+	bool storeBinary(GLuint program, const QString & path, uint64_t key, QString & error);
+
+private:
+	bool enabled_;
+	size_t hits_ = 0;
+	size_t misses_ = 0;
+};
@@ -0,0 +1,373 @@
+#include "Renderer.h"
+
+#include <Base/Trace.hpp>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+
+constexpr std::array<GLfloat, 21u> vertices = {
+	0.0f, 0.707f, 1.f, 0.f, 0.f, 0.0f, 0.0f,
+	-0.5f, -0.5f, 0.f, 1.f, 0.f, 0.5f, 1.0f,
+	0.5f, -0.5f, 0.f, 0.f, 1.f, 1.0f, 0.0f,
+};
+constexpr std::array<GLuint, 3u> indices = {0, 1, 2};
+
+// About 0.5 GB/s at 60 FPS, small enough to keep a streaming frame within budget.
+constexpr size_t g_upload_bytes_per_frame = 8u << 20;
+
+// The triangle shown until the scene is ready has vertex colors and the fallback texture.
+constexpr uint32_t g_triangle_features = ShaderVariants::VertexColor | ShaderVariants::Texture;
+
+QByteArray readResource(const QString & path)
+{
+	QFile file(path);
+	return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+}// namespace
+
+Renderer::Renderer(RenderSettings settings) noexcept
+	: settings_{std::move(settings)}
+	, programCache_{settings_.programCache}
+{
+}
+
+void Renderer::init()
+{
+	FGL_TRACE_SCOPE("Renderer::init");
+
+	initializeOpenGLFunctions();
+
+	jobs_ = std::make_unique<fgl::JobSystem>(settings_.jobWorkers < 0 ? fgl::JobSystem::defaultWorkers()
+																	  : static_cast<size_t>(settings_.jobWorkers));
+	qInfo() << "Job threads:" << jobs_->threadCount();
+
+	// Configure shaders, the variant of the triangle is built up front and scene variants on first use
+	QElapsedTimer programTimer;
+	programTimer.start();
+	shaders_.create(readResource(":/Shaders/diffuse.vs"), readResource(":/Shaders/diffuse.fs"));
+	if (!shaders_.variant(g_triangle_features))
+	{
+		qWarning() << "Failed to build shaders";
+	}
+	programTime_ = programTimer.elapsed();
+
+	// Create uniform ring
+	if (!uniforms_.create())
+	{
+		qWarning() << "Failed to create the uniform buffer";
+	}
+
+	// Create VAO object
+	vao_.create();
+	vao_.bind();
+
+	// Create VBO
+	vbo_.create();
+	vbo_.bind();
+	vbo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	vbo_.allocate(vertices.data(), static_cast<int>(vertices.size() * sizeof(GLfloat)));
+
+	// Create IBO
+	ibo_.create();
+	ibo_.bind();
+	ibo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	ibo_.allocate(indices.data(), static_cast<int>(indices.size() * sizeof(GLuint)));
+
+	texture_ = std::make_unique<QOpenGLTexture>(QImage(":/Textures/voronoi.png"));
+	texture_->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+	texture_->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
+
+	// Bind attributes, locations are the same in every variant
+	const auto attribute = [&](const GLuint location, const GLint size, const size_t offset) {
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(7 * sizeof(GLfloat)),
+							  reinterpret_cast<const void *>(offset * sizeof(GLfloat)));
+	};
+	attribute(GltfScene::g_position_location, 2, 0);
+	attribute(GltfScene::g_color_location, 3, 2);
+	attribute(GltfScene::g_texcoord_location, 2, 5);
+
+	// The triangle never moves
+	model_ = fgl::translation({0.0f, 0.0f, -2.0f});
+
+	// Release all
+	vao_.release();
+
+	ibo_.release();
+	vbo_.release();
+
+	// Load glTF scene
+	loadScene();
+
+	// Create timer queries
+	if (!gpuTimer_.create())
+	{
+		qInfo() << "Timer queries are not supported, GPU timings are disabled";
+	}
+
+	// Еnable depth test and face culling
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+
+	// Clear all FBO buffers
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void Renderer::destroy()
+{
+	loader_.reset();
+	gpuTimer_.destroy();
+	scene_.destroy();
+	animation_.clear();
+	asset_.reset();
+	cache_.reset();
+	texture_.reset();
+	uniforms_.destroy();
+	shaders_.destroy();
+	vao_.destroy();
+	ibo_.destroy();
+	vbo_.destroy();
+	jobs_.reset();
+}
+
+void Renderer::render(const float time, const bool animated)
+{
+	FGL_TRACE_SCOPE("Renderer::render");
+
+	streamScene();
+
+	gpuTimer_.beginFrame();
+
+	// Clear buffers
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	gpuTimer_.endSection(ClearSection);
+
+	if (!scene_.empty())
+	{
+		// Look at the whole scene
+		const auto center = (scene_.boundsMin() + scene_.boundsMax()) * 0.5f;
+		const fgl::Vec3 target(center.x(), center.y(), center.z());
+		view_ = fgl::lookAt(target + fgl::Vec3(0.0f, 0.6f, 1.8f) * sceneRadius_, target, fgl::Vec3(0.0f, 1.0f, 0.0f));
+
+		// Play the file's animations, models without any get their morph targets swept
+		if (animated)
+		{
+			if (!animation_.empty())
+			{
+				animation_.apply(time, scene_, *jobs_);
+			}
+			else
+			{
+				animateMorphs(time);
+			}
+		}
+		scene_.updateMorphs(*jobs_);
+		scene_.updateTransforms(*jobs_);
+
+		scene_.draw(shaders_, uniforms_, projection_ * view_, *texture_, *jobs_);
+	}
+	else
+	{
+		renderTriangle();
+	}
+	gpuTimer_.endSection(DrawSection);
+	gpuTimer_.endFrame();
+}
+
+void Renderer::animateMorphs(const float time)
+{
+	for (size_t mesh = 0; mesh < scene_.meshCount(); ++mesh)
+	{
+		morphWeights_.resize(scene_.morphTargetCount(mesh));
+		if (morphWeights_.empty())
+		{
+			continue;
+		}
+
+		for (size_t target = 0; target < morphWeights_.size(); ++target)
+		{
+			morphWeights_[target] = 0.5f - 0.5f * std::cos(time + static_cast<float>(target));
+		}
+		scene_.setMorphWeights(mesh, morphWeights_);
+	}
+}
+
+void Renderer::renderTriangle()
+{
+	// Calculate view matrix
+	view_ = fgl::Mat4(1.0f);
+
+	// Write pass-through draw uniforms
+	const GltfScene::DrawUniforms uniforms;
+	if (!uniforms_.beginFrame(uniforms_.alignedSize(sizeof(uniforms))))
+	{
+		return;
+	}
+	const auto offset = uniforms_.write(std::as_bytes(std::span{&uniforms, 1}));
+	uniforms_.flush();
+
+	// Bind VAO and shader program
+	const auto * variant = shaders_.variant(g_triangle_features);
+	if (!variant)
+	{
+		uniforms_.endFrame();
+		return;
+	}
+	auto & program = *variant->program;
+	program.bind();
+	vao_.bind();
+
+	// Update uniform value, the model matrix is a constant attribute without instancing
+	const auto viewProjection = projection_ * view_;
+	glUniformMatrix4fv(variant->viewProjectionUniform, 1, GL_FALSE, fgl::elements(viewProjection).data());
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		glVertexAttrib4fv(GltfScene::g_model_location + column, fgl::elements(model_).data() + column * 4);
+	}
+	uniforms_.bindRange(GltfScene::g_draw_uniforms_binding, offset, sizeof(uniforms));
+
+	// Activate texture unit and bind texture
+	glActiveTexture(GL_TEXTURE0);
+	texture_->bind();
+
+	// Draw
+	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+
+	// Release VAO and shader program
+	texture_->release();
+	vao_.release();
+	program.release();
+	uniforms_.endFrame();
+}
+
+void Renderer::resize(const size_t width, const size_t height)
+{
+	width_ = width;
+	height_ = height;
+
+	// Configure viewport
+	glViewport(0, 0, static_cast<GLint>(width), static_cast<GLint>(height));
+
+	updateProjection();
+}
+
+void Renderer::updateProjection()
+{
+	// Configure matrix
+	const auto aspect = static_cast<float>(width_) / static_cast<float>(height_);
+	const auto zNear = 0.1f;
+	const auto zFar = std::max(100.0f, sceneRadius_ * 10.0f);
+	const auto fov = 60.0f;
+	projection_ = fgl::perspective(fov, aspect, zNear, zFar);
+}
+
+void Renderer::loadScene()
+{
+	FGL_TRACE_SCOPE("Renderer::loadScene");
+
+	if (settings_.modelPath.isEmpty())
+	{
+		return;
+	}
+
+	loader_ = std::make_unique<AssetLoader>(settings_.modelPath, settings_.loadMode, settings_.sceneCache,
+											settings_.vertexFormat);
+	if (settings_.asyncLoading)
+	{
+		return;
+	}
+
+	loader_->wait();
+	do
+	{
+		streamScene();
+	} while (streaming_);
+}
+
+void Renderer::beginScene(std::unique_ptr<GltfAsset> asset, std::unique_ptr<SceneCache> cache, const qint64 loadTime)
+{
+	asset_ = std::move(asset);
+	cache_ = std::move(cache);
+	loadTime_ = loadTime;
+	uploadTimer_.start();
+	streaming_ = true;
+
+	scene_.setCulling(settings_.frustumCulling);
+	if (cache_)
+	{
+		scene_.begin(*cache_);
+	}
+	else
+	{
+		scene_.begin(*asset_, settings_.morphMode);
+	}
+
+	animation_.clear();
+	if (asset_)
+	{
+		animation_.create(*asset_);
+		if (!animation_.select(settings_.animationClip) && animation_.clipCount() > 0)
+		{
+			qWarning() << "No animation" << settings_.animationClip << "of" << animation_.clipCount() << "in the model, playing the first";
+		}
+	}
+	if (!animation_.empty())
+	{
+		qInfo() << "Animation:" << animation_.clipName(animation_.selected()).c_str() << "of" << animation_.clipCount() << "clips,"
+				<< animation_.channelCount() << "channels," << animation_.duration() << "s";
+	}
+	if (scene_.skinCount() > 0)
+	{
+		qInfo() << "Skins:" << scene_.skinCount();
+	}
+	if (!scene_.empty())
+	{
+		sceneRadius_ = std::max(0.5f * (scene_.boundsMax() - scene_.boundsMin()).length(), 0.01f);
+		updateProjection();
+	}
+}
+
+void Renderer::streamScene()
+{
+	// Pick up a finished asset
+	if (loader_ && loader_->finished())
+	{
+		QString error;
+		auto asset = loader_->take(error);
+		auto cache = loader_->takeCache();
+		const auto loadTime = loader_->loadTime();
+		loader_.reset();
+
+		if (!asset && !cache)
+		{
+			qWarning() << "Failed to load" << settings_.modelPath << ":" << error;
+			return;
+		}
+		beginScene(std::move(asset), std::move(cache), loadTime);
+	}
+
+	if (!streaming_)
+	{
+		return;
+	}
+
+	// Upload a bounded slice per frame
+	if (scene_.upload(g_upload_bytes_per_frame))
+	{
+		streaming_ = false;
+		qInfo() << "Loaded" << settings_.modelPath << (cache_ ? "(cached)" : asset_->mapped() ? "(mapped)" : "(copied)")
+				<< "parse:" << loadTime_ << "ms, upload:" << uploadTimer_.elapsed() << "ms,"
+				<< scene_.uploadedBytes() / 1024 << "KiB," << scene_.instanceCount() << "nodes in"
+				<< scene_.drawCallCount() << "draw calls";
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <Base/GpuTimer.hpp>
+#include <Base/JobSystem.hpp>
+#include <Base/Math.hpp>
+#include <Base/UniformRing.hpp>
+
+#include "AssetLoader.h"
+#include "GltfAnimation.h"
+#include "GltfAsset.h"
+#include "GltfScene.h"
+#include "ProgramCache.h"
+#include "ShaderVariants.h"
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QElapsedTimer>
+#include <QOpenGLVertexArrayObject>
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+struct RenderSettings {
+	QString modelPath = ":/Models/chess.glb";
+	GltfAsset::LoadMode loadMode = GltfAsset::LoadMode::Mapped;
+	GltfScene::MorphMode morphMode = GltfScene::MorphMode::Gpu;
+	// Parse on a worker thread and stream GPU data in over several frames.
+	bool asyncLoading = true;
+	// Start from a ready-to-upload copy of the scene, written on first load.
+	bool sceneCache = true;
+	// Load linked shader programs from binaries stored on first start.
+	bool programCache = true;
+	// Skip nodes outside the view frustum.
+	bool frustumCulling = true;
+	// Vertex layout of cached scenes.
+	SceneCache::VertexFormat vertexFormat = SceneCache::VertexFormat::Float;
+	// Animation of the model that plays, clips usually drive the same nodes.
+	size_t animationClip = 0;
+	// Threads helping the rendering one with per-frame CPU work, negative for one per remaining core.
+	int jobWorkers = -1;
+};
+
+// Everything drawn into the current framebuffer, shared by the window and the headless benchmark.
+// All methods require a current context.
+class Renderer final : protected QOpenGLFunctions
+{
+public:
+	explicit Renderer(RenderSettings settings) noexcept;
+
+	Renderer(const Renderer &) = delete;
+	Renderer(Renderer &&) = delete;
+
+	Renderer & operator=(const Renderer &) = delete;
+	Renderer & operator=(Renderer &&) = delete;
+
+	void init();
+	void destroy();
+
+	// The scene's animations, or synthetic morph weights without any, are evaluated at `time` seconds.
+	void render(float time, bool animated);
+	void resize(size_t width, size_t height);
+
+	[[nodiscard]] const RenderSettings & settings() const noexcept { return settings_; }
+
+	// GPU time of the clear and draw sections, a few frames behind.
+	[[nodiscard]] const fgl::GpuTimer & gpuTimer() const noexcept { return gpuTimer_; }
+	// Time init() spent building the first shader variant, and how many programs came from binaries.
+	[[nodiscard]] qint64 programTime() const noexcept { return programTime_; }
+	[[nodiscard]] const ProgramCache & programCache() const noexcept { return programCache_; }
+	[[nodiscard]] const ShaderVariants & shaderVariants() const noexcept { return shaders_; }
+	// Threads running per-frame jobs, the rendering one included.
+	[[nodiscard]] size_t jobThreads() const noexcept { return jobs_ ? jobs_->threadCount() : 0; }
+
+	// Draw calls and state changes of the last scene frame.
+	[[nodiscard]] const fgl::SubmitStats & submitStats() const noexcept { return scene_.submitStats(); }
+
+	enum Section : size_t
+	{
+		ClearSection,
+		DrawSection,
+	};
+
+private:
+	void loadScene();
+	void beginScene(std::unique_ptr<GltfAsset> asset, std::unique_ptr<SceneCache> cache, qint64 loadTime);
+	void streamScene();
+	void updateProjection();
+	void animateMorphs(float time);
+	void renderTriangle();
+
+private:
+	RenderSettings settings_;
+
+	QOpenGLBuffer vbo_{QOpenGLBuffer::Type::VertexBuffer};
+	QOpenGLBuffer ibo_{QOpenGLBuffer::Type::IndexBuffer};
+	QOpenGLVertexArrayObject vao_;
+
+	fgl::Mat4 model_{1.0f};
+	fgl::Mat4 view_{1.0f};
+	fgl::Mat4 projection_{1.0f};
+
+	std::unique_ptr<QOpenGLTexture> texture_;
+	ProgramCache programCache_;
+	ShaderVariants shaders_{programCache_};
+	qint64 programTime_ = 0;
+	fgl::UniformRing uniforms_;
+
+	size_t width_ = 1;
+	size_t height_ = 1;
+
+	std::unique_ptr<AssetLoader> loader_;
+	std::unique_ptr<GltfAsset> asset_;
+	std::unique_ptr<SceneCache> cache_;
+	GltfScene scene_;
+	GltfAnimation animation_;
+	float sceneRadius_ = 1.0f;
+	qint64 loadTime_ = 0;
+	QElapsedTimer uploadTimer_;
+	bool streaming_ = false;
+
+	std::vector<float> morphWeights_;
+
+	// Animation, morphing, skinning, culling and sort keys of every frame.
+	std::unique_ptr<fgl::JobSystem> jobs_;
+
+	fgl::GpuTimer gpuTimer_{{"clear", "draw"}};
+};
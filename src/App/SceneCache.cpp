@@ -0,0 +1,746 @@
+#include "SceneCache.h"
+
+#include <Base/Hash.hpp>
+#include <Base/MeshOptimizer.hpp>
+#include <Base/Quantize.hpp>
+#include <Base/Trace.hpp>
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+
+constexpr std::array<char, 4> g_magic = {'F', 'G', 'L', 'S'};
+// Sections start on cache line boundaries so they can be used in place from the mapping.
+constexpr uint64_t g_alignment = 64;
+constexpr uint32_t g_max_levels = 32;
+
+enum SectionIndex : size_t
+{
+	PrimitiveSection,
+	DrawSection,
+	VertexSection,
+	IndexSection,
+	TextureSection,
+	PixelSection,
+	SectionCount,
+};
+
+struct Section {
+	uint64_t offset;
+	uint64_t bytes;
+};
+
+struct Header {
+	std::array<char, 4> magic;
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t size;
+	uint64_t meshCount;
+	SceneCache::VertexFormat vertexFormat;
+	uint32_t reserved;
+	float boundsMin[3];
+	float boundsMax[3];
+	Section sections[SectionCount];
+};
+
+static_assert(std::is_trivially_copyable_v<Header>);
+static_assert(std::is_trivially_copyable_v<SceneCache::Primitive>);
+static_assert(std::is_trivially_copyable_v<SceneCache::Draw>);
+static_assert(std::is_trivially_copyable_v<SceneCache::Texture>);
+
+struct QuantizedVertex {
+	uint16_t position[4];
+	uint8_t color[4];
+	uint16_t texcoord[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 16);
+
+struct Bounds {
+	QVector3D min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+	QVector3D max = -min;
+
+	[[nodiscard]] bool empty() const noexcept { return min.x() > max.x(); }
+
+	void grow(const QVector3D & point)
+	{
+		min = QVector3D(std::min(min.x(), point.x()), std::min(min.y(), point.y()), std::min(min.z(), point.z()));
+		max = QVector3D(std::max(max.x(), point.x()), std::max(max.y(), point.y()), std::max(max.z(), point.z()));
+	}
+};
+
+// Contents of a cache before they are laid out in the file.
+struct Contents {
+	std::vector<SceneCache::Primitive> primitives;
+	std::vector<SceneCache::Draw> draws;
+	SceneCache::VertexFormat format = SceneCache::VertexFormat::Float;
+	std::vector<std::byte> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<SceneCache::Texture> textures;
+	std::vector<uint8_t> pixels;
+
+	std::vector<Bounds> meshBounds;
+	Bounds bounds;
+
+	fgl::MeshOptimizer optimizer;
+	fgl::VertexCacheStats before;
+	fgl::VertexCacheStats after;
+};
+
+struct Decoded {
+	std::vector<float> values;
+	size_t count = 0;
+	uint32_t components = 0;
+};
+
+uint64_t align(const uint64_t offset)
+{
+	return (offset + g_alignment - 1) / g_alignment * g_alignment;
+}
+
+size_t levelBytes(const SceneCache::Texture & texture, const uint32_t level)
+{
+	return size_t{std::max(texture.width >> level, 1u)} * std::max(texture.height >> level, 1u) * 4;
+}
+
+template<typename T>
+bool sectionOf(const std::byte * data, const Section & section, std::span<const T> & out)
+{
+	if (section.bytes % sizeof(T) != 0)
+	{
+		return false;
+	}
+	out = {reinterpret_cast<const T *>(data + section.offset), section.bytes / sizeof(T)};
+	return true;
+}
+
+Decoded decode(const GltfAsset & asset, const fgl::MorphBlender & blender, const tinygltf::Primitive & primitive,
+			   const char * name)
+{
+	const auto it = primitive.attributes.find(name);
+	if (it == primitive.attributes.end())
+	{
+		return {};
+	}
+
+	const auto stream = asset.attribute(it->second);
+	if (!stream.data || stream.components == 0)
+	{
+		return {};
+	}
+
+	Decoded decoded;
+	decoded.count = stream.count;
+	decoded.components = stream.components;
+	decoded.values.resize(stream.count * stream.components);
+	blender.blend(stream, {}, {}, decoded.values);
+	return decoded;
+}
+
+bool readIndices(const GltfAsset & asset, const int accessor, std::vector<uint32_t> & out)
+{
+	const auto & model = asset.model();
+	if (accessor < 0 || static_cast<size_t>(accessor) >= model.accessors.size())
+	{
+		return false;
+	}
+
+	const auto & source = model.accessors[static_cast<size_t>(accessor)];
+	const auto view = asset.bufferView(source.bufferView);
+	if (view.empty())
+	{
+		return false;
+	}
+
+	const auto size = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(source.componentType));
+	const auto stride = source.ByteStride(model.bufferViews[static_cast<size_t>(source.bufferView)]);
+	if ((size != 1 && size != 2 && size != 4) || stride <= 0 || source.count == 0
+		|| source.byteOffset + (source.count - 1) * static_cast<size_t>(stride) + static_cast<size_t>(size) > view.size())
+	{
+		return false;
+	}
+
+	const auto * element = view.data() + source.byteOffset;
+	for (size_t i = 0; i < source.count; ++i, element += stride)
+	{
+		uint32_t index = 0;
+		if (size == 1)
+		{
+			index = std::to_integer<uint32_t>(*element);
+		}
+		else if (size == 2)
+		{
+			uint16_t value = 0;
+			std::memcpy(&value, element, sizeof(value));
+			index = value;
+		}
+		else
+		{
+			std::memcpy(&index, element, sizeof(index));
+		}
+		out.push_back(index);
+	}
+	return true;
+}
+
+void appendVertices(const std::vector<float> & vertices, SceneCache::Primitive & primitive, Contents & contents)
+{
+	constexpr auto stride = SceneCache::g_vertex_floats;
+	const auto count = vertices.size() / stride;
+
+	std::fill_n(primitive.positionOffset, 3, 0.0f);
+	std::fill_n(primitive.positionScale, 3, 1.0f);
+	if (contents.format == SceneCache::VertexFormat::Float)
+	{
+		const auto bytes = std::as_bytes(std::span(vertices));
+		contents.vertices.insert(contents.vertices.end(), bytes.begin(), bytes.end());
+		return;
+	}
+
+	// Positions are stored relative to the bounds of their primitive, which keeps the error of a
+	// 16-bit coordinate below 1/131070 of the primitive size.
+	for (size_t axis = 0; axis < 3; ++axis)
+	{
+		auto min = std::numeric_limits<float>::max();
+		auto max = std::numeric_limits<float>::lowest();
+		for (size_t vertex = 0; vertex < count; ++vertex)
+		{
+			min = std::min(min, vertices[vertex * stride + axis]);
+			max = std::max(max, vertices[vertex * stride + axis]);
+		}
+		primitive.positionOffset[axis] = count > 0 ? min : 0.0f;
+		primitive.positionScale[axis] = count > 0 ? max - min : 0.0f;
+	}
+
+	const auto offset = contents.vertices.size();
+	contents.vertices.resize(offset + count * sizeof(QuantizedVertex));
+	for (size_t vertex = 0; vertex < count; ++vertex)
+	{
+		const auto * source = vertices.data() + vertex * stride;
+
+		QuantizedVertex quantized{};
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			const auto scale = primitive.positionScale[axis];
+			quantized.position[axis] = scale > 0.0f ? fgl::toUnorm16((source[axis] - primitive.positionOffset[axis]) / scale) : 0;
+			quantized.color[axis] = fgl::toUnorm8(source[3 + axis]);
+		}
+		quantized.color[3] = 255;
+		quantized.texcoord[0] = fgl::toHalf(source[6]);
+		quantized.texcoord[1] = fgl::toHalf(source[7]);
+
+		std::memcpy(contents.vertices.data() + offset + vertex * sizeof(QuantizedVertex), &quantized, sizeof(quantized));
+	}
+}
+
+void addPrimitive(const GltfAsset & asset, const fgl::MorphBlender & blender, const uint32_t mesh,
+				  const tinygltf::Primitive & source, Contents & contents)
+{
+	const auto & model = asset.model();
+
+	const auto positions = decode(asset, blender, source, "POSITION");
+	if (positions.components != 3 || positions.count == 0)
+	{
+		return;
+	}
+	auto vertexCount = positions.count;
+
+	SceneCache::Primitive primitive{};
+	primitive.mesh = mesh;
+	primitive.mode = static_cast<uint32_t>(source.mode >= 0 ? source.mode : TINYGLTF_MODE_TRIANGLES);
+	primitive.texture = -1;
+
+	std::vector<uint32_t> indices;
+	if (source.indices >= 0)
+	{
+		if (!readIndices(asset, source.indices, indices)
+			|| std::any_of(indices.begin(), indices.end(), [&](const uint32_t index) { return index >= vertexCount; }))
+		{
+			return;
+		}
+	}
+
+	// Primitives without vertex colors get the material color baked in.
+	std::array<float, 3> color = {1.0f, 1.0f, 1.0f};
+	if (source.material >= 0 && static_cast<size_t>(source.material) < model.materials.size())
+	{
+		const auto & pbr = model.materials[static_cast<size_t>(source.material)].pbrMetallicRoughness;
+		if (pbr.baseColorFactor.size() >= 3)
+		{
+			std::transform(pbr.baseColorFactor.begin(), pbr.baseColorFactor.begin() + 3, color.begin(),
+						   [](const double value) { return static_cast<float>(value); });
+		}
+		const auto texture = pbr.baseColorTexture.index;
+		primitive.texture = texture >= 0 && static_cast<size_t>(texture) < model.textures.size() ? texture : -1;
+	}
+
+	auto colors = decode(asset, blender, source, "COLOR_0");
+	if (colors.components < 3 || colors.count < vertexCount)
+	{
+		colors = {};
+	}
+	auto texcoords = decode(asset, blender, source, "TEXCOORD_0");
+	if (texcoords.components != 2 || texcoords.count < vertexCount)
+	{
+		texcoords = {};
+	}
+
+	std::vector<float> vertices;
+	vertices.reserve(vertexCount * SceneCache::g_vertex_floats);
+	Bounds bounds;
+	for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		const auto * position = positions.values.data() + vertex * 3;
+		vertices.insert(vertices.end(), position, position + 3);
+		bounds.grow(QVector3D(position[0], position[1], position[2]));
+
+		const auto * rgb = colors.values.empty() ? color.data() : colors.values.data() + vertex * colors.components;
+		vertices.insert(vertices.end(), rgb, rgb + 3);
+
+		if (texcoords.values.empty())
+		{
+			vertices.insert(vertices.end(), {0.0f, 0.0f});
+		}
+		else
+		{
+			const auto * texcoord = texcoords.values.data() + vertex * 2;
+			vertices.insert(vertices.end(), texcoord, texcoord + 2);
+		}
+	}
+
+	// Exporters leave triangles in arbitrary order, the cache stores them ready for the vertex cache.
+	if (primitive.mode == TINYGLTF_MODE_TRIANGLES && indices.size() >= 3 && indices.size() % 3 == 0)
+	{
+		contents.before += contents.optimizer.analyze(indices, vertexCount);
+		contents.optimizer.reorderTriangles(indices, vertices, SceneCache::g_vertex_floats);
+		const auto remap = fgl::MeshOptimizer::reorderVertices(indices, vertexCount);
+		vertexCount = fgl::MeshOptimizer::remapVertices(vertices, SceneCache::g_vertex_floats, remap);
+		contents.after += contents.optimizer.analyze(indices, vertexCount);
+	}
+
+	contents.meshBounds[mesh].grow(bounds.min);
+	contents.meshBounds[mesh].grow(bounds.max);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		primitive.boundsMin[axis] = bounds.min[axis];
+		primitive.boundsMax[axis] = bounds.max[axis];
+	}
+
+	primitive.firstVertex = static_cast<uint32_t>(contents.vertices.size() / SceneCache::vertexSize(contents.format));
+	primitive.vertexCount = static_cast<uint32_t>(vertexCount);
+	primitive.firstIndex = static_cast<uint32_t>(contents.indices.size());
+	primitive.indexCount = static_cast<uint32_t>(indices.size());
+	appendVertices(vertices, primitive, contents);
+	contents.indices.insert(contents.indices.end(), indices.begin(), indices.end());
+	contents.primitives.push_back(primitive);
+}
+
+void collectDraws(const tinygltf::Model & model, const int node, const QMatrix4x4 & parent, Contents & contents)
+{
+	if (node < 0 || static_cast<size_t>(node) >= model.nodes.size())
+	{
+		return;
+	}
+
+	const auto & source = model.nodes[static_cast<size_t>(node)];
+	const auto world = parent * GltfAsset::localMatrix(source);
+
+	if (source.mesh >= 0 && static_cast<size_t>(source.mesh) < model.meshes.size())
+	{
+		SceneCache::Draw draw{};
+		draw.mesh = static_cast<uint32_t>(source.mesh);
+		std::copy_n(world.constData(), 16, draw.world);
+		contents.draws.push_back(draw);
+
+		const auto & bounds = contents.meshBounds[static_cast<size_t>(source.mesh)];
+		for (int corner = 0; !bounds.empty() && corner < 8; ++corner)
+		{
+			contents.bounds.grow(world.map(QVector3D(corner & 1 ? bounds.max.x() : bounds.min.x(),
+													 corner & 2 ? bounds.max.y() : bounds.min.y(),
+													 corner & 4 ? bounds.max.z() : bounds.min.z())));
+		}
+	}
+
+	for (const auto child: source.children)
+	{
+		collectDraws(model, child, world, contents);
+	}
+}
+
+// 2x2 box filter, the last row or column is repeated for odd sizes.
+void downsample(const uint8_t * source, const uint32_t width, const uint32_t height, uint8_t * target)
+{
+	const auto targetWidth = std::max(width / 2, 1u);
+	const auto targetHeight = std::max(height / 2, 1u);
+	for (uint32_t y = 0; y < targetHeight; ++y)
+	{
+		const auto * row0 = source + size_t{std::min(y * 2, height - 1)} * width * 4;
+		const auto * row1 = source + size_t{std::min(y * 2 + 1, height - 1)} * width * 4;
+		for (uint32_t x = 0; x < targetWidth; ++x)
+		{
+			const auto x0 = size_t{std::min(x * 2, width - 1)} * 4;
+			const auto x1 = size_t{std::min(x * 2 + 1, width - 1)} * 4;
+			for (size_t c = 0; c < 4; ++c)
+			{
+				*target++ = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+			}
+		}
+	}
+}
+
+void addTexture(const tinygltf::Model & model, const tinygltf::Texture & source, Contents & contents)
+{
+	auto & texture = contents.textures.emplace_back();
+	if (source.source < 0 || static_cast<size_t>(source.source) >= model.images.size())
+	{
+		return;
+	}
+
+	// Same formats as GltfScene::createTexture.
+	const auto & image = model.images[static_cast<size_t>(source.source)];
+	if (image.image.empty() || image.bits != 8 || (image.component != 3 && image.component != 4)
+		|| image.width <= 0 || image.height <= 0)
+	{
+		return;
+	}
+
+	texture.width = static_cast<uint32_t>(image.width);
+	texture.height = static_cast<uint32_t>(image.height);
+	texture.levels = 1;
+	while ((std::max(texture.width, texture.height) >> texture.levels) != 0)
+	{
+		++texture.levels;
+	}
+	texture.offset = contents.pixels.size();
+
+	size_t bytes = 0;
+	for (uint32_t level = 0; level < texture.levels; ++level)
+	{
+		bytes += levelBytes(texture, level);
+	}
+	contents.pixels.resize(contents.pixels.size() + bytes);
+
+	auto * pixels = contents.pixels.data() + texture.offset;
+	const auto texels = size_t{texture.width} * texture.height;
+	for (size_t texel = 0; texel < texels; ++texel)
+	{
+		const auto * source = image.image.data() + texel * static_cast<size_t>(image.component);
+		std::copy_n(source, image.component, pixels + texel * 4);
+		if (image.component == 3)
+		{
+			pixels[texel * 4 + 3] = 255;
+		}
+	}
+
+	for (uint32_t level = 1; level < texture.levels; ++level)
+	{
+		const auto * previous = pixels;
+		pixels += levelBytes(texture, level - 1);
+		downsample(previous, std::max(texture.width >> (level - 1), 1u), std::max(texture.height >> (level - 1), 1u), pixels);
+	}
+}
+
+bool build(const GltfAsset & asset, Contents & contents, QString & error)
+{
+	FGL_TRACE_SCOPE("SceneCache::build");
+
+	const auto & model = asset.model();
+	if (!model.animations.empty())
+	{
+		error = "animations are not cached";
+		return false;
+	}
+	if (!model.skins.empty())
+	{
+		error = "skins are not cached";
+		return false;
+	}
+	for (const auto & mesh: model.meshes)
+	{
+		for (const auto & primitive: mesh.primitives)
+		{
+			if (!primitive.targets.empty())
+			{
+				error = "morph targets are not cached";
+				return false;
+			}
+		}
+	}
+
+	const fgl::MorphBlender blender;
+	contents.meshBounds.resize(model.meshes.size());
+	for (size_t mesh = 0; mesh < model.meshes.size(); ++mesh)
+	{
+		for (const auto & primitive: model.meshes[mesh].primitives)
+		{
+			addPrimitive(asset, blender, static_cast<uint32_t>(mesh), primitive, contents);
+		}
+	}
+
+	if (!model.scenes.empty())
+	{
+		const auto scene = model.defaultScene >= 0 ? static_cast<size_t>(model.defaultScene) : 0;
+		for (const auto node: model.scenes[scene].nodes)
+		{
+			collectDraws(model, node, QMatrix4x4{}, contents);
+		}
+	}
+
+	if (contents.before.triangles > 0)
+	{
+		qInfo() << "Vertex cache" << contents.optimizer.cacheSize() << "ACMR:" << contents.before.acmr() << "->"
+				<< contents.after.acmr() << "ATVR:" << contents.before.atvr() << "->" << contents.after.atvr();
+	}
+
+	for (const auto & texture: model.textures)
+	{
+		addTexture(model, texture, contents);
+	}
+	return true;
+}
+
+}// namespace
+
+SceneCache::~SceneCache()
+{
+	if (mapping_)
+	{
+		file_.unmap(mapping_);
+	}
+}
+
+std::optional<uint64_t> SceneCache::hashFile(const QString & path)
+{
+	FGL_TRACE_SCOPE("SceneCache::hashFile");
+
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return std::nullopt;
+	}
+
+	if (auto * mapping = file.map(0, file.size()))
+	{
+		const auto hash = fgl::hash64({reinterpret_cast<const std::byte *>(mapping), static_cast<size_t>(file.size())});
+		file.unmap(mapping);
+		return hash;
+	}
+
+	// Compressed Qt resources can not be mapped.
+	const auto bytes = file.readAll();
+	return fgl::hash64({reinterpret_cast<const std::byte *>(bytes.constData()), static_cast<size_t>(bytes.size())});
+}
+
+size_t SceneCache::vertexSize(const VertexFormat format) noexcept
+{
+	return format == VertexFormat::Quantized ? sizeof(QuantizedVertex) : g_vertex_floats * sizeof(float);
+}
+
+QString SceneCache::pathFor(const uint64_t sourceHash, const VertexFormat format)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/scenes/"
+		+ QString::number(sourceHash, 16).rightJustified(16, '0')
+		+ (format == VertexFormat::Quantized ? "-quantized.fglscene" : ".fglscene");
+}
+
+auto SceneCache::open(const QString & path, const uint64_t sourceHash) -> std::unique_ptr<SceneCache>
+{
+	FGL_TRACE_SCOPE("SceneCache::open");
+
+	auto cache = std::unique_ptr<SceneCache>(new SceneCache());
+	if (!cache->map(path, sourceHash))
+	{
+		return nullptr;
+	}
+	return cache;
+}
+
+bool SceneCache::write(const GltfAsset & asset, const uint64_t sourceHash, const VertexFormat format,
+					   const QString & path, QString & error)
+{
+	FGL_TRACE_SCOPE("SceneCache::write");
+
+	Contents contents;
+	contents.format = format;
+	if (!build(asset, contents, error))
+	{
+		return false;
+	}
+
+	Header header{};
+	header.magic = g_magic;
+	header.version = g_version;
+	header.sourceHash = sourceHash;
+	header.meshCount = asset.model().meshes.size();
+	header.vertexFormat = format;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.boundsMin[axis] = contents.bounds.min[axis];
+		header.boundsMax[axis] = contents.bounds.max[axis];
+	}
+
+	const std::array<std::span<const std::byte>, SectionCount> sections = {
+		std::as_bytes(std::span(contents.primitives)),
+		std::as_bytes(std::span(contents.draws)),
+		std::as_bytes(std::span(contents.vertices)),
+		std::as_bytes(std::span(contents.indices)),
+		std::as_bytes(std::span(contents.textures)),
+		std::as_bytes(std::span(contents.pixels)),
+	};
+
+	uint64_t offset = sizeof(Header);
+	for (size_t i = 0; i < SectionCount; ++i)
+	{
+		offset = align(offset);
+		header.sections[i] = {offset, sections[i].size()};
+		offset += sections[i].size();
+	}
+	header.size = offset;
+
+	if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+	{
+		error = QString("Failed to create %1").arg(QFileInfo(path).absolutePath());
+		return false;
+	}
+
+	// Written to a temporary file and renamed, readers never see a partial cache.
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		error = QString("Failed to create %1: %2").arg(path, file.errorString());
+		return false;
+	}
+
+	static constexpr std::array<char, g_alignment> padding{};
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	for (size_t i = 0; i < SectionCount; ++i)
+	{
+		file.write(padding.data(), static_cast<qint64>(header.sections[i].offset) - file.pos());
+		file.write(reinterpret_cast<const char *>(sections[i].data()), static_cast<qint64>(sections[i].size()));
+	}
+
+	if (!file.commit())
+	{
+		error = QString("Failed to write %1: %2").arg(path, file.errorString());
+		return false;
+	}
+	return true;
+}
+
+std::span<const std::byte> SceneCache::level(const Texture & texture, const uint32_t level) const noexcept
+{
+	if (level >= texture.levels)
+	{
+		return {};
+	}
+
+	auto offset = texture.offset;
+	for (uint32_t i = 0; i < level; ++i)
+	{
+		offset += levelBytes(texture, i);
+	}
+	return pixels_.subspan(offset, levelBytes(texture, level));
+}
+
+bool SceneCache::map(const QString & path, const uint64_t sourceHash)
+{
+	file_.setFileName(path);
+	if (!file_.open(QIODevice::ReadOnly) || file_.size() < static_cast<qint64>(sizeof(Header)))
+	{
+		return false;
+	}
+
+	mapping_ = file_.map(0, file_.size());
+	if (!mapping_)
+	{
+		return false;
+	}
+
+	const auto * data = reinterpret_cast<const std::byte *>(mapping_);
+	const auto size = static_cast<uint64_t>(file_.size());
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != g_magic || header.version != g_version || header.sourceHash != sourceHash || header.size != size
+		|| (header.vertexFormat != VertexFormat::Float && header.vertexFormat != VertexFormat::Quantized))
+	{
+		return false;
+	}
+
+	for (const auto & section: header.sections)
+	{
+		if (section.offset % g_alignment != 0 || section.offset > size || section.bytes > size - section.offset)
+		{
+			qWarning() << "Malformed scene cache" << path;
+			return false;
+		}
+	}
+
+	if (!sectionOf(data, header.sections[PrimitiveSection], primitives_)
+		|| !sectionOf(data, header.sections[DrawSection], draws_)
+		|| !sectionOf(data, header.sections[VertexSection], vertices_)
+		|| !sectionOf(data, header.sections[IndexSection], indices_)
+		|| !sectionOf(data, header.sections[TextureSection], textures_)
+		|| !sectionOf(data, header.sections[PixelSection], pixels_))
+	{
+		qWarning() << "Malformed scene cache" << path;
+		return false;
+	}
+
+	meshCount_ = header.meshCount;
+	vertexFormat_ = header.vertexFormat;
+	boundsMin_ = QVector3D(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	boundsMax_ = QVector3D(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+	// Ranges, modes and index values are checked once here so uploads can trust them. The file has no
+	// checksum, so this is all that stands between a damaged cache and the GPU.
+	const auto vertexCount = uint64_t{vertices_.size() / vertexSize(vertexFormat_)};
+	const auto valid = std::all_of(primitives_.begin(), primitives_.end(), [&](const Primitive & primitive) {
+		if (primitive.mesh >= meshCount_ || primitive.mode > TINYGLTF_MODE_TRIANGLE_FAN
+			|| uint64_t{primitive.firstVertex} + primitive.vertexCount > vertexCount
+			|| uint64_t{primitive.firstIndex} + primitive.indexCount > indices_.size()
+			|| primitive.texture < -1 || primitive.texture >= static_cast<int64_t>(textures_.size()))
+		{
+			return false;
+		}
+		// Indices are relative to firstVertex.
+		const auto indices = indices_.subspan(primitive.firstIndex, primitive.indexCount);
+		return std::all_of(indices.begin(), indices.end(), [&](const uint32_t index) { return index < primitive.vertexCount; });
+	}) && std::all_of(draws_.begin(), draws_.end(), [&](const Draw & draw) {
+		return draw.mesh < meshCount_;
+	}) && std::all_of(textures_.begin(), textures_.end(), [&](const Texture & texture) {
+		if (texture.levels == 0)
+		{
+			return true;
+		}
+		if (texture.levels > g_max_levels || texture.width == 0 || texture.height == 0)
+		{
+			return false;
+		}
+		uint64_t bytes = 0;
+		for (uint32_t level = 0; level < texture.levels; ++level)
+		{
+			bytes += levelBytes(texture, level);
+		}
+		return texture.offset <= pixels_.size() && bytes <= pixels_.size() - texture.offset;
+	});
+	if (!valid)
+	{
+		qWarning() << "Malformed scene cache" << path;
+		return false;
+	}
+
+	return true;
+}
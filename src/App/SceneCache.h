@@ -0,0 +1,125 @@
+#pragma once
+
+#include "GltfAsset.h"
+
+#include <QFile>
+#include <QString>
+#include <QVector3D>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+
+// A glTF scene converted to exactly what GltfScene uploads: one interleaved vertex stream, 32-bit
+// indices reordered for the vertex cache, the draw list and RGBA8 textures with their whole mip chain.
+// Everything sits in one aligned file named after a hash of the source, so a warm start is one mapping
+// and no tinygltf.
+// Files are only meant for the machine that wrote them.
+class SceneCache final
+{
+public:
+	// Bump whenever the layout or the processing changes, older files then fail to open and get rebuilt.
+	static constexpr uint32_t g_version = 6;
+
+	enum class VertexFormat : uint32_t
+	{
+		// 32 bytes: float position, color and texture coordinates.
+		Float,
+		// 16 bytes: unorm16 position within the primitive bounds, unorm8 RGBA color, half texture coordinates.
+		Quantized,
+	};
+
+	// Floats per vertex before quantization: position, color and texture coordinates.
+	static constexpr size_t g_vertex_floats = 8;
+
+	[[nodiscard]] static size_t vertexSize(VertexFormat format) noexcept;
+
+	struct Primitive {
+		uint32_t mesh;
+		uint32_t mode;
+		uint32_t firstVertex;
+		uint32_t vertexCount;
+		// Indices are relative to firstVertex, no indices means an array draw.
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t texture;
+		uint32_t reserved;
+		// Stored positions map to offset + position * scale, identity for float vertices.
+		float positionOffset[3];
+		float positionScale[3];
+		// Object-space bounds for culling.
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	struct Draw {
+		uint32_t mesh;
+		// Column-major world matrix.
+		float world[16];
+	};
+
+	// Mip levels are packed from `offset` into pixels(), level 0 first. No levels for textures that
+	// were not decodable, they are drawn with the fallback texture.
+	struct Texture {
+		uint32_t width;
+		uint32_t height;
+		uint32_t levels;
+		uint32_t reserved;
+		uint64_t offset;
+	};
+
+	// Hash of the file contents, the cache key.
+	[[nodiscard]] static std::optional<uint64_t> hashFile(const QString & path);
+	// Where the cache for a source hash and vertex format lives.
+	[[nodiscard]] static QString pathFor(uint64_t sourceHash, VertexFormat format);
+
+	// Null if the file is missing, stale or malformed.
+	[[nodiscard]] static std::unique_ptr<SceneCache> open(const QString & path, uint64_t sourceHash);
+	// Fails for assets GltfScene can not take from a cache, i.e. with morph targets, animations or skins.
+	static bool write(const GltfAsset & asset, uint64_t sourceHash, VertexFormat format, const QString & path,
+					  QString & error);
+
+	SceneCache(const SceneCache &) = delete;
+	SceneCache(SceneCache &&) = delete;
+
+	SceneCache & operator=(const SceneCache &) = delete;
+	SceneCache & operator=(SceneCache &&) = delete;
+
+	~SceneCache();
+
+public:
+	[[nodiscard]] size_t meshCount() const noexcept { return meshCount_; }
+	[[nodiscard]] std::span<const Primitive> primitives() const noexcept { return primitives_; }
+	[[nodiscard]] std::span<const Draw> draws() const noexcept { return draws_; }
+	[[nodiscard]] VertexFormat vertexFormat() const noexcept { return vertexFormat_; }
+	[[nodiscard]] std::span<const std::byte> vertices() const noexcept { return vertices_; }
+	[[nodiscard]] std::span<const uint32_t> indices() const noexcept { return indices_; }
+	[[nodiscard]] std::span<const Texture> textures() const noexcept { return textures_; }
+	[[nodiscard]] std::span<const std::byte> level(const Texture & texture, uint32_t level) const noexcept;
+
+	[[nodiscard]] QVector3D boundsMin() const noexcept { return boundsMin_; }
+	[[nodiscard]] QVector3D boundsMax() const noexcept { return boundsMax_; }
+
+private:
+	SceneCache() = default;
+
+	bool map(const QString & path, uint64_t sourceHash);
+
+private:
+	QFile file_;
+	uchar * mapping_ = nullptr;
+
+	size_t meshCount_ = 0;
+	VertexFormat vertexFormat_ = VertexFormat::Float;
+	std::span<const Primitive> primitives_;
+	std::span<const Draw> draws_;
+	std::span<const std::byte> vertices_;
+	std::span<const uint32_t> indices_;
+	std::span<const Texture> textures_;
+	std::span<const std::byte> pixels_;
+
+	QVector3D boundsMin_;
+	QVector3D boundsMax_;
+};
@@ -0,0 +1,160 @@
+#include "ShaderVariants.h"
+
+#include "GltfScene.h"
+
+#include <Base/Trace.hpp>
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <array>
+#include <utility>
+
+namespace
+{
+
+// Inserts `defines` after the #version line, which has to stay first.
+QByteArray specialize(const QByteArray & source, const QByteArray & defines)
+{
+	const auto version = source.indexOf("#version");
+	const auto end = version >= 0 ? source.indexOf('\n', version) : -1;
+	if (end < 0)
+	{
+		return defines + source;
+	}
+	auto result = source;
+	result.insert(end + 1, defines);
+	return result;
+}
+
+}// namespace
+
+uint32_t ShaderVariants::morphTargets(const size_t count) noexcept
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+	if (count <= 2)
+	{
+		return MorphTargets2;
+	}
+	return count <= 4 ? MorphTargets4 : MorphTargets8;
+}
+
+QByteArray ShaderVariants::defines(const uint32_t features)
+{
+	QByteArray result;
+	if (features & VertexColor)
+	{
+		result += "#define VERTEX_COLOR\n";
+	}
+	if (features & Texture)
+	{
+		result += "#define TEXTURE\n";
+	}
+	if (features & Quantized)
+	{
+		result += "#define QUANTIZED\n";
+	}
+	if (features & Skin)
+	{
+		result += "#define SKIN\n";
+	}
+	constexpr std::array morphTargetCounts = {0, 2, 4, 8};
+	result += "#define MORPH_TARGETS " + QByteArray::number(morphTargetCounts[(features & MorphTargetsMask) >> 3]) + "\n";
+	return result;
+}
+
+ShaderVariants::ShaderVariants(ProgramCache & cache) noexcept
+	: cache_{cache}
+{
+}
+
+void ShaderVariants::create(QByteArray vertexSource, QByteArray fragmentSource)
+{
+	destroy();
+	vertexSource_ = std::move(vertexSource);
+	fragmentSource_ = std::move(fragmentSource);
+}
+
+void ShaderVariants::destroy()
+{
+	for (auto & variant: variants_)
+	{
+		variant.reset();
+	}
+	failed_.fill(false);
+	built_ = 0;
+}
+
+const ShaderVariants::Variant * ShaderVariants::variant(const uint32_t features)
+{
+	if (features >= g_variant_count)
+	{
+		return nullptr;
+	}
+	auto & variant = variants_[features];
+	if (!variant && !failed_[features])
+	{
+		variant = build(features);
+		failed_[features] = !variant;
+	}
+	return variant.get();
+}
+
+std::unique_ptr<ShaderVariants::Variant> ShaderVariants::build(const uint32_t features)
+{
+	FGL_TRACE_SCOPE("ShaderVariants::build");
+
+	initializeOpenGLFunctions();
+
+	QElapsedTimer timer;
+	timer.start();
+
+	const auto defines = ShaderVariants::defines(features);
+	const std::array shaders = {
+		ProgramCache::Shader{QOpenGLShader::Vertex, specialize(vertexSource_, defines)},
+		ProgramCache::Shader{QOpenGLShader::Fragment, specialize(fragmentSource_, defines)},
+	};
+
+	auto variant = std::make_unique<Variant>();
+	variant->program = std::make_unique<QOpenGLShaderProgram>();
+	const auto hits = cache_.hits();
+	QString error;
+	if (!cache_.build(*variant->program, shaders, error))
+	{
+		qWarning() << "Failed to build shader variant" << defines.simplified() << ":" << error;
+		return nullptr;
+	}
+
+	// Samplers and the uniform block binding are program state, set once.
+	auto & program = *variant->program;
+	program.bind();
+	if (features & Texture)
+	{
+		program.setUniformValue("tex_2d", 0);
+	}
+	if (features & MorphTargetsMask)
+	{
+		program.setUniformValue("morph_deltas", 1);
+	}
+	if (features & Skin)
+	{
+		program.setUniformValue("joint_matrices", 2);
+	}
+	program.release();
+
+	// Variants that use no per-draw uniforms have the block optimized away.
+	const auto block = glGetUniformBlockIndex(program.programId(), "DrawUniforms");
+	if (block != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(program.programId(), block, GltfScene::g_draw_uniforms_binding);
+	}
+	variant->viewProjectionUniform = program.uniformLocation("view_projection");
+	variant->id = static_cast<uint32_t>(built_++);
+
+	qInfo() << "Built shader variant" << defines.simplified() << "in" << timer.elapsed() << "ms"
+			<< (cache_.hits() > hits ? "(cached)" : "(compiled)");
+	return variant;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ProgramCache.h"
+
+#include <QByteArray>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// The diffuse shaders specialized with #defines for the features a draw call uses, so no variant
+// pays for morphing, skinning, dequantization or texturing it does not need. A variant is built through the
+// program cache the first time it is asked for and kept for its feature mask.
+class ShaderVariants final : protected QOpenGLExtraFunctions
+{
+public:
+	enum Feature : uint32_t
+	{
+		// Per-vertex colors, else the primitive's base color.
+		VertexColor = 1u << 0,
+		Texture = 1u << 1,
+		// Positions are unorm16 within the primitive bounds.
+		Quantized = 1u << 2,
+		// Two bits for morphing with up to 2, 4 or 8 active targets.
+		MorphTargets2 = 1u << 3,
+		MorphTargets4 = 2u << 3,
+		MorphTargets8 = 3u << 3,
+		MorphTargetsMask = 3u << 3,
+		// Linear blend skinning with joint matrices from a texture.
+		Skin = 1u << 5,
+	};
+
+	static constexpr size_t g_variant_count = 1u << 6;
+
+	// Smallest morph feature with room for `count` active targets, none for 0.
+	[[nodiscard]] static uint32_t morphTargets(size_t count) noexcept;
+	// The #define lines of a feature mask.
+	[[nodiscard]] static QByteArray defines(uint32_t features);
+
+	struct Variant {
+		std::unique_ptr<QOpenGLShaderProgram> program;
+		int viewProjectionUniform = -1;
+		// Creation order, small enough for the program field of a RenderQueue key.
+		uint32_t id = 0;
+	};
+
+	explicit ShaderVariants(ProgramCache & cache) noexcept;
+
+	ShaderVariants(const ShaderVariants &) = delete;
+	ShaderVariants(ShaderVariants &&) = delete;
+
+	ShaderVariants & operator=(const ShaderVariants &) = delete;
+	ShaderVariants & operator=(ShaderVariants &&) = delete;
+
+	// Sources get the defines of a variant inserted after their #version line.
+	void create(QByteArray vertexSource, QByteArray fragmentSource);
+	void destroy();
+
+	// Requires a current context. Null if the variant fails to build, which is only reported once.
+	[[nodiscard]] const Variant * variant(uint32_t features);
+	// Variants built so far.
+	[[nodiscard]] size_t size() const noexcept { return built_; }
+
+private:
+	[[nodiscard]] std::unique_ptr<Variant> build(uint32_t features);
+
+private:
+	ProgramCache & cache_;
+	QByteArray vertexSource_;
+	QByteArray fragmentSource_;
+	std::array<std::unique_ptr<Variant>, g_variant_count> variants_;
+	std::array<bool, g_variant_count> failed_{};
+	size_t built_ = 0;
+};
@@ -1,14 +1,22 @@
 #version 330 core
 
+#ifdef TEXTURE
 uniform sampler2D tex_2d;
+#endif
 
 in vec3 vert_col;
+#ifdef TEXTURE
 in vec2 vert_tex;
+#endif
 
 out vec4 out_col;
 
 void main() {
+#ifdef TEXTURE
 	vec4 texel = texture(tex_2d, vert_tex);
 	float greyscale_factor = dot(texel.rgb, vec3(0.21, 0.71, 0.07));
+#else
+	float greyscale_factor = 1.0;
+#endif
 	out_col = vec4(mix(vec3(greyscale_factor), vert_col.rgb, 0.7), 1.0f);
-}
\ No newline at end of file
+}
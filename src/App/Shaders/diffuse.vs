@@ -1,16 +1,102 @@
 #version 330 core
 
-layout(location=0) in vec2 pos;
+// Specialized by ShaderVariants, which inserts the defines of a variant above:
+// VERTEX_COLOR, TEXTURE, QUANTIZED, SKIN and MORPH_TARGETS (0, 2, 4 or 8).
+#ifndef MORPH_TARGETS
+#define MORPH_TARGETS 0
+#endif
+
+// Array sizes of the block, must match GltfScene::g_max_active_targets.
+#define MAX_MORPH_TARGETS 8
+
+layout(location=0) in vec3 pos;
+#ifdef VERTEX_COLOR
 layout(location=1) in vec3 col;
+#endif
+#ifdef TEXTURE
 layout(location=2) in vec2 tex;
+#endif
+// Per instance, see GltfScene::g_model_location. Identity for skinned instances, whose joint
+// matrices already hold the world transform.
+layout(location=3) in mat4 model;
+#ifdef SKIN
+layout(location=7) in uvec4 joints;
+layout(location=8) in vec4 weights;
+#endif
+
+uniform mat4 view_projection;
+
+// Per draw call, see GltfScene::DrawUniforms. Every variant declares the same layout.
+layout(std140) uniform DrawUniforms {
+	// Quantized positions are normalized to the primitive bounds.
+	vec4 position_offset;
+	vec4 position_scale;
+	// Color of primitives without vertex colors.
+	vec4 base_color;
+	// Active targets and vertices per target in x and y.
+	ivec4 morph_params;
+	// First joint matrix of the draw's first instance and joints per instance in x and y.
+	ivec4 skin_params;
+	ivec4 morph_targets[MAX_MORPH_TARGETS / 4];
+	vec4 morph_weights[MAX_MORPH_TARGETS / 4];
+};
+
+#if MORPH_TARGETS > 0
+// Deltas of all morph targets, texel (target * vertices + vertex) holds one delta.
+uniform sampler2D morph_deltas;
+#endif
 
-uniform mat4 mvp;
+#ifdef SKIN
+// Joint matrices of the visible instances, three texels (the top rows of an affine matrix) per joint.
+uniform sampler2D joint_matrices;
+#endif
 
 out vec3 vert_col;
+#ifdef TEXTURE
 out vec2 vert_tex;
+#endif
+
+vec3 morph(vec3 position) {
+#if MORPH_TARGETS > 0
+	int width = textureSize(morph_deltas, 0).x;
+	for (int i = 0; i < MORPH_TARGETS && i < morph_params.x; ++i) {
+		int texel = morph_targets[i / 4][i % 4] * morph_params.y + gl_VertexID;
+		position += morph_weights[i / 4][i % 4] * texelFetch(morph_deltas, ivec2(texel % width, texel / width), 0).xyz;
+	}
+#endif
+	return position;
+}
+
+vec3 skin(vec3 position) {
+#ifdef SKIN
+	int width = textureSize(joint_matrices, 0).x;
+	int first = skin_params.x + gl_InstanceID * skin_params.y;
+	vec4 rows[3] = vec4[3](vec4(0.0), vec4(0.0), vec4(0.0));
+	for (int i = 0; i < 4; ++i) {
+		int texel = (first + int(joints[i])) * 3;
+		for (int row = 0; row < 3; ++row) {
+			rows[row] += weights[i] * texelFetch(joint_matrices, ivec2((texel + row) % width, (texel + row) / width), 0);
+		}
+	}
+	vec4 point = vec4(position, 1.0);
+	position = vec3(dot(rows[0], point), dot(rows[1], point), dot(rows[2], point));
+#endif
+	return position;
+}
 
 void main() {
+#ifdef VERTEX_COLOR
 	vert_col = col;
+#else
+	vert_col = base_color.rgb;
+#endif
+#ifdef TEXTURE
 	vert_tex = tex;
-	gl_Position = mvp * vec4(pos.xy, 0.0, 1.0);
+#endif
+#ifdef QUANTIZED
+	vec3 position = position_offset.xyz + pos * position_scale.xyz;
+#else
+	vec3 position = pos;
+#endif
+	gl_Position = view_projection * (model * vec4(skin(morph(position)), 1.0));
 }
@@ -0,0 +1,7 @@
+// Single translation unit with the tinygltf, stb_image and stb_image_write implementations.
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include <tinygltf/tiny_gltf.h>
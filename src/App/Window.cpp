@@ -1,177 +1,168 @@
 #include "Window.h"
 
+#include <Base/Trace.hpp>
+
+#include <QDebug>
+#include <QHBoxLayout>
+#include <QKeyEvent>
 #include <QMouseEvent>
 #include <QLabel>
-#include <QOpenGLFunctions>
-#include <QOpenGLShaderProgram>
 #include <QVBoxLayout>
 #include <QScreen>
 
-#include <array>
-
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <cmath>
+#include <optional>
 
-#include <tinygltf/tiny_gltf.h>
-
-namespace
+Window::Window(RenderSettings settings) noexcept
+	: renderer_{std::move(settings)}
 {
+	startupTimer_.start();
 
-constexpr std::array<GLfloat, 21u> vertices = {
-	0.0f, 0.707f, 1.f, 0.f, 0.f, 0.0f, 0.0f,
-	-0.5f, -0.5f, 0.f, 1.f, 0.f, 0.5f, 1.0f,
-	0.5f, -0.5f, 0.f, 0.f, 1.f, 1.0f, 0.0f,
-};
-constexpr std::array<GLuint, 3u> indices = {0, 1, 2};
-
-}// namespace
-
-Window::Window() noexcept
-{
 	const auto formatFPS = [](const auto value) {
 		return QString("FPS: %1").arg(QString::number(value));
 	};
 
+	const auto formatFrames = [](const QString & label, const fgl::FrameSummary & summary) {
+		return QString("%1 p50: %2 ms p95: %3 ms p99: %4 ms worst: %5 ms stutters: %6")
+			.arg(label)
+			.arg(summary.p50, 0, 'f', 1)
+			.arg(summary.p95, 0, 'f', 1)
+			.arg(summary.p99, 0, 'f', 1)
+			.arg(summary.worst, 0, 'f', 1)
+			.arg(summary.stutters);
+	};
+
 	auto fps = new QLabel(formatFPS(0), this);
 	fps->setStyleSheet("QLabel { color : white; }");
 
+	auto frames = new QLabel(formatFrames("CPU", {}), this);
+	frames->setStyleSheet("QLabel { color : white; }");
+
+	auto gpuFrames = new QLabel(formatFrames("GPU", {}), this);
+	gpuFrames->setStyleSheet("QLabel { color : white; }");
+
+	auto timings = new QVBoxLayout();
+	timings->addWidget(frames);
+	timings->addWidget(gpuFrames);
+
+	auto metrics = new QHBoxLayout();
+	metrics->addWidget(fps);
+	metrics->addLayout(timings, 1);
+
 	auto layout = new QVBoxLayout();
-	layout->addWidget(fps, 1);
+	layout->addLayout(metrics, 1);
 
 	setLayout(layout);
 
 	timer_.start();
 
-	connect(this, &Window::updateUI, [=] {
-		fps->setText(formatFPS(ui_.fps));
+	// Keys are only delivered with focus.
+	setFocusPolicy(Qt::StrongFocus);
+
+	// Queued when emitted on a render thread, only the newest metrics are shown.
+	connect(this, &Window::updateUI, this, [=] {
+		std::optional<UiUpdate> latest;
+		while (const auto update = uiUpdates_.pop())
+		{
+			latest = update;
+		}
+		if (latest)
+		{
+			fps->setText(formatFPS(latest->fps));
+			frames->setText(formatFrames("CPU", latest->frames));
+			gpuFrames->setText(formatFrames("GPU", latest->gpuFrames));
+		}
 	});
 }
 
 Window::~Window()
 {
-	{
-		// Free resources with context bounded.
-		const auto guard = bindContext();
-		texture_.reset();
-		program_.reset();
-	}
+	// Free resources with context bounded.
+	stopRendering();
 }
 
 void Window::onInit()
 {
-	// Configure shaders
-	program_ = std::make_unique<QOpenGLShaderProgram>(this);
-	program_->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/Shaders/diffuse.vs");
-	program_->addShaderFromSourceFile(QOpenGLShader::Fragment,
-									  ":/Shaders/diffuse.fs");
-	program_->link();
-
-	// Create VAO object
-	vao_.create();
-	vao_.bind();
-
-	// Create VBO
-	vbo_.create();
-	vbo_.bind();
-	vbo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	vbo_.allocate(vertices.data(), static_cast<int>(vertices.size() * sizeof(GLfloat)));
-
-	// Create IBO
-	ibo_.create();
-	ibo_.bind();
-	ibo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	ibo_.allocate(indices.data(), static_cast<int>(indices.size() * sizeof(GLuint)));
-
-	texture_ = std::make_unique<QOpenGLTexture>(QImage(":/Textures/voronoi.png"));
-	texture_->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
-	texture_->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
-
-	// Bind attributes
-	program_->bind();
-
-	program_->enableAttributeArray(0);
-	program_->setAttributeBuffer(0, GL_FLOAT, 0, 2, static_cast<int>(7 * sizeof(GLfloat)));
-
-	program_->enableAttributeArray(1);
-	program_->setAttributeBuffer(1, GL_FLOAT, static_cast<int>(2 * sizeof(GLfloat)), 3,
-								 static_cast<int>(7 * sizeof(GLfloat)));
+	FGL_TRACE_SCOPE("Window::onInit");
 
-	program_->enableAttributeArray(2);
-	program_->setAttributeBuffer(2, GL_FLOAT, static_cast<int>(5 * sizeof(GLfloat)), 2,
-								 static_cast<int>(7 * sizeof(GLfloat)));
-
-	mvpUniform_ = program_->uniformLocation("mvp");
-
-	// Release all
-	program_->release();
-
-	vao_.release();
-
-	ibo_.release();
-	vbo_.release();
-
-	// Еnable depth test and face culling
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
-
-	// Clear all FBO buffers
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	renderer_.init();
+	animationTimer_.start();
 }
 
 void Window::onRender()
 {
-	const auto guard = captureMetrics();
+	FGL_TRACE_SCOPE("Window::onRender");
 
-	// Clear buffers
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	// Calculate MVP matrix
-	model_.setToIdentity();
-	model_.translate(0, 0, -2);
-	view_.setToIdentity();
-	const auto mvp = projection_ * view_ * model_;
-
-	// Bind VAO and shader program
-	program_->bind();
-	vao_.bind();
-
-	// Update uniform value
-	program_->setUniformValue(mvpUniform_, mvp);
-
-	// Activate texture unit and bind texture
-	glActiveTexture(GL_TEXTURE0);
-	texture_->bind();
-
-	// Draw
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+	const auto guard = captureMetrics();
 
-	// Release VAO and shader program
-	texture_->release();
-	vao_.release();
-	program_->release();
+	applyInputs();
+	renderer_.render(static_cast<float>(animationTimer_.elapsed()) / 1000.0f, animated_);
 
 	++frameCount_;
 
+	if (firstFrame_)
+	{
+		firstFrame_ = false;
+		qInfo() << "First frame after" << startupTimer_.elapsed() << "ms";
+	}
+
 	// Request redraw if animated
 	if (animated_)
 	{
-		update();
+		requestFrame();
 	}
 }
 
 void Window::onResize(const size_t width, const size_t height)
 {
-	// Configure viewport
-	glViewport(0, 0, static_cast<GLint>(width), static_cast<GLint>(height));
-
-	// Configure matrix
-	const auto aspect = static_cast<float>(width) / static_cast<float>(height);
-	const auto zNear = 0.1f;
-	const auto zFar = 100.0f;
-	const auto fov = 60.0f;
-	projection_.setToIdentity();
-	projection_.perspective(fov, aspect, zNear, zFar);
+	renderer_.resize(width, height);
+}
+
+void Window::onDestroy()
+{
+	renderer_.destroy();
+}
+
+void Window::applyInputs()
+{
+	while (const auto input = inputs_.pop())
+	{
+		switch (*input)
+		{
+		case Input::ToggleAnimation:
+			animated_ = !animated_;
+			break;
+		}
+	}
+}
+
+void Window::keyPressEvent(QKeyEvent * event)
+{
+	// Write the trace recorded so far.
+	if (event->key() == Qt::Key_F12 && fgl::Trace::enabled())
+	{
+		if (fgl::Trace::flush())
+		{
+			qInfo() << "Trace written";
+		}
+		else
+		{
+			qWarning() << "Failed to write trace";
+		}
+		return;
+	}
+
+	// Pause or resume the morph animation.
+	if (event->key() == Qt::Key_Space)
+	{
+		if (!inputs_.push(Input::ToggleAnimation))
+		{
+			qWarning() << "Input queue is full";
+		}
+		requestFrame();
+		return;
+	}
+	fgl::GLWidget::keyPressEvent(event);
 }
 
 Window::PerfomanceMetricsGuard::PerfomanceMetricsGuard(std::function<void()> callback)
@@ -189,14 +180,25 @@ Window::PerfomanceMetricsGuard::~PerfomanceMetricsGuard()
 
 auto Window::captureMetrics() -> PerfomanceMetricsGuard
 {
+	frameTimer_.start();
 	return PerfomanceMetricsGuard{
 		[&] {
+			frameStats_.push(static_cast<float>(frameTimer_.nsecsElapsed()) / 1e6f);
+
 			if (timer_.elapsed() >= 1000)
 			{
 				const auto elapsedSeconds = static_cast<float>(timer_.restart()) / 1000.0f;
-				ui_.fps = static_cast<size_t>(std::round(frameCount_ / elapsedSeconds));
+				const UiUpdate update{
+					static_cast<size_t>(std::round(frameCount_ / elapsedSeconds)),
+					frameStats_.summary(),
+					renderer_.gpuTimer().frameStats().summary(),
+				};
 				frameCount_ = 0;
-				emit updateUI();
+				// A full queue means the GUI thread is busy, it only shows the newest update anyway.
+				if (uiUpdates_.push(update))
+				{
+					emit updateUI();
+				}
 			}
 		}
 	};
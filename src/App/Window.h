@@ -1,28 +1,35 @@
 #pragma once
 
+#include <Base/FrameStats.hpp>
 #include <Base/GLWidget.hpp>
+#include <Base/SpscQueue.hpp>
+
+#include "Renderer.h"
 
 #include <QElapsedTimer>
-#include <QMatrix4x4>
-#include <QOpenGLBuffer>
-#include <QOpenGLShaderProgram>
-#include <QOpenGLTexture>
-#include <QOpenGLVertexArrayObject>
 
 #include <functional>
-#include <memory>
 
 class Window final : public fgl::GLWidget
 {
 	Q_OBJECT
 public:
-	Window() noexcept;
+	explicit Window(RenderSettings settings = {}) noexcept;
 	~Window() override;
 
 public: // fgl::GLWidget
 	void onInit() override;
 	void onRender() override;
 	void onResize(size_t width, size_t height) override;
+	void onDestroy() override;
+
+public:
+	// CPU time of the last frames, safe to read from any thread.
+	[[nodiscard]] const fgl::FrameStats & frameStats() const noexcept { return frameStats_; }
+	[[nodiscard]] const fgl::GpuTimer & gpuTimer() const noexcept { return renderer_.gpuTimer(); }
+
+protected: // QWidget
+	void keyPressEvent(QKeyEvent * event) override;
 
 private:
 	class PerfomanceMetricsGuard final
@@ -43,30 +50,42 @@ private:
 
 private:
 	[[nodiscard]] PerfomanceMetricsGuard captureMetrics();
+	void applyInputs();
 
 signals:
+	// Metrics are waiting in uiUpdates_, emitted on the rendering thread.
 	void updateUI();
 
 private:
-	GLint mvpUniform_ = -1;
+	Renderer renderer_;
 
-	QOpenGLBuffer vbo_{QOpenGLBuffer::Type::VertexBuffer};
-	QOpenGLBuffer ibo_{QOpenGLBuffer::Type::IndexBuffer};
-	QOpenGLVertexArrayObject vao_;
-
-	QMatrix4x4 model_;
-	QMatrix4x4 view_;
-	QMatrix4x4 projection_;
-
-	std::unique_ptr<QOpenGLTexture> texture_;
-	std::unique_ptr<QOpenGLShaderProgram> program_;
+	QElapsedTimer animationTimer_;
 
 	QElapsedTimer timer_;
 	size_t frameCount_ = 0;
 
-	struct {
+	QElapsedTimer frameTimer_;
+	fgl::FrameStats frameStats_;
+
+	QElapsedTimer startupTimer_;
+	bool firstFrame_ = true;
+
+	struct UiUpdate {
 		size_t fps = 0;
-	} ui_;
+		fgl::FrameSummary frames;
+		fgl::FrameSummary gpuFrames;
+	};
+
+	enum class Input
+	{
+		ToggleAnimation,
+	};
+
+	// Input goes from the GUI thread to the rendering one and metrics back, which are different threads
+	// with threaded rendering.
+	fgl::SpscQueue<Input, 64> inputs_;
+	fgl::SpscQueue<UiUpdate, 8> uiUpdates_;
 
+	// Rendering thread only.
 	bool animated_ = true;
 };
@@ -0,0 +1,288 @@
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QSurfaceFormat>
+#include <QTextStream>
+
+#include <Base/FrameStats.hpp>
+#include <Base/Trace.hpp>
+
+#include "Renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+constexpr auto g_gl_major_version = 3;
+constexpr auto g_gl_minor_version = 3;
+constexpr auto g_frame_rate = 60.0f;
+// Exit code of a run whose last frame differs too much from the reference image.
+constexpr auto g_diff_failed = 2;
+
+QJsonObject toJson(const fgl::FrameSummary & summary)
+{
+	QJsonObject object;
+	object["mean"] = summary.mean;
+	object["p50"] = summary.p50;
+	object["p95"] = summary.p95;
+	object["p99"] = summary.p99;
+	object["max"] = summary.worst;
+	return object;
+}
+
+// Per-channel difference of the RGB channels, alpha is ignored. Empty object if the sizes differ.
+QJsonObject compareImages(const QImage & image, const QImage & reference)
+{
+	QJsonObject object;
+	if (image.size() != reference.size())
+	{
+		return object;
+	}
+
+	const auto lhs = image.convertToFormat(QImage::Format_RGBA8888);
+	const auto rhs = reference.convertToFormat(QImage::Format_RGBA8888);
+
+	int max = 0;
+	double sum = 0.0;
+	double squared = 0.0;
+	for (int y = 0; y < lhs.height(); ++y)
+	{
+		const auto * lhsRow = lhs.constScanLine(y);
+		const auto * rhsRow = rhs.constScanLine(y);
+		for (int x = 0; x < lhs.width() * 4; ++x)
+		{
+			if (x % 4 == 3)
+			{
+				continue;
+			}
+			const auto difference = std::abs(lhsRow[x] - rhsRow[x]);
+			max = std::max(max, difference);
+			sum += difference;
+			squared += difference * difference;
+		}
+	}
+
+	const auto samples = static_cast<double>(lhs.width()) * lhs.height() * 3.0;
+	object["max"] = max;
+	object["mean"] = sum / samples;
+	// Identical images have no PSNR.
+	if (squared > 0.0)
+	{
+		object["psnr"] = 10.0 * std::log10(255.0 * 255.0 / (squared / samples));
+	}
+	return object;
+}
+}// namespace
+
+int main(int argc, char ** argv)
+{
+	QGuiApplication app(argc, argv);
+
+	// Parse command line.
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Renders frames offscreen and prints frame-time percentiles as JSON.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("model", "glTF model to render.");
+	const QCommandLineOption framesOption("frames", "Number of measured frames.", "count", "500");
+	const QCommandLineOption warmupOption("warmup", "Number of frames rendered before measuring.", "count", "20");
+	const QCommandLineOption widthOption("width", "Framebuffer width.", "pixels", "1280");
+	const QCommandLineOption heightOption("height", "Framebuffer height.", "pixels", "720");
+	const QCommandLineOption loadModeOption("load-mode", "glTF loading mode: mapped or copy.", "mode", "mapped");
+	const QCommandLineOption morphOption("morph", "Morph target blending: gpu or cpu.", "mode", "gpu");
+	const QCommandLineOption asyncLoadOption("async-load", "Stream the model in while measuring instead of loading it first.");
+	const QCommandLineOption noCacheOption("no-cache", "Always parse the model, neither read nor write the scene cache.");
+	const QCommandLineOption noProgramCacheOption("no-program-cache", "Always compile shaders, neither read nor write program binaries.");
+	const QCommandLineOption noCullingOption("no-culling", "Draw every node instead of culling against the view frustum.");
+	const QCommandLineOption vertexFormatOption("vertex-format", "Vertex layout of cached scenes: float or quantized.", "format", "float");
+	const QCommandLineOption saveImageOption("save-image", "Save the last frame.", "file");
+	const QCommandLineOption diffImageOption("diff-image", "Compare the last frame with a reference image.", "file");
+	const QCommandLineOption minPsnrOption("min-psnr", "Fail with exit code 2 if the difference to --diff-image is lower.", "dB", "40");
+	const QCommandLineOption clipOption("clip", "Animation of the model to play, the first by default.", "index");
+	const QCommandLineOption jobsOption("jobs", "Worker threads for per-frame CPU work, 0 keeps it on the render thread. One per remaining core by default.", "count");
+	const QCommandLineOption traceOption("trace", "Record a Chrome trace of the run.", "file");
+	parser.addOptions({framesOption, warmupOption, widthOption, heightOption, loadModeOption, morphOption, asyncLoadOption,
+					   noCacheOption, noProgramCacheOption, noCullingOption, vertexFormatOption, saveImageOption, diffImageOption, minPsnrOption, clipOption, jobsOption, traceOption});
+	parser.process(app);
+
+	RenderSettings settings;
+	if (!parser.positionalArguments().isEmpty())
+	{
+		settings.modelPath = parser.positionalArguments().front();
+	}
+	settings.loadMode = parser.value(loadModeOption) == "copy"
+		? GltfAsset::LoadMode::Copy
+		: GltfAsset::LoadMode::Mapped;
+	settings.morphMode = parser.value(morphOption) == "cpu"
+		? GltfScene::MorphMode::Cpu
+		: GltfScene::MorphMode::Gpu;
+	settings.asyncLoading = parser.isSet(asyncLoadOption);
+	settings.sceneCache = !parser.isSet(noCacheOption);
+	settings.programCache = !parser.isSet(noProgramCacheOption);
+	settings.frustumCulling = !parser.isSet(noCullingOption);
+	settings.vertexFormat = parser.value(vertexFormatOption) == "quantized"
+		? SceneCache::VertexFormat::Quantized
+		: SceneCache::VertexFormat::Float;
+	if (parser.isSet(clipOption))
+	{
+		settings.animationClip = static_cast<size_t>(std::max(parser.value(clipOption).toInt(), 0));
+	}
+	if (parser.isSet(jobsOption))
+	{
+		settings.jobWorkers = std::max(parser.value(jobsOption).toInt(), 0);
+	}
+
+	const auto frames = std::max(parser.value(framesOption).toInt(), 1);
+	const auto warmup = std::max(parser.value(warmupOption).toInt(), 0);
+	const QSize size(std::max(parser.value(widthOption).toInt(), 1), std::max(parser.value(heightOption).toInt(), 1));
+
+	if (parser.isSet(traceOption))
+	{
+		fgl::Trace::setThreadName("main");
+		fgl::Trace::start(parser.value(traceOption).toStdString());
+	}
+
+	// Create context on an offscreen surface.
+	QSurfaceFormat format;
+	format.setVersion(g_gl_major_version, g_gl_minor_version);
+	format.setProfile(QSurfaceFormat::CoreProfile);
+
+	QOpenGLContext context;
+	context.setFormat(format);
+	if (!context.create())
+	{
+		qCritical() << "Failed to create OpenGL" << g_gl_major_version << "." << g_gl_minor_version << "context";
+		return 1;
+	}
+
+	QOffscreenSurface surface;
+	surface.setFormat(context.format());
+	surface.create();
+	if (!surface.isValid() || !context.makeCurrent(&surface))
+	{
+		qCritical() << "Failed to make the offscreen surface current";
+		return 1;
+	}
+
+	// Render into an FBO instead of the default framebuffer.
+	auto * functions = context.functions();
+	const auto glRenderer = QString::fromLatin1(reinterpret_cast<const char *>(functions->glGetString(GL_RENDERER)));
+
+	fgl::FrameStats stats{static_cast<size_t>(frames)};
+	QJsonObject gpuTimes;
+	QJsonObject submitStats;
+	QJsonObject programStats;
+	qint64 jobThreads = 0;
+	QImage lastFrame;
+	{
+		QOpenGLFramebufferObject fbo(size, QOpenGLFramebufferObject::CombinedDepthStencil);
+		fbo.bind();
+
+		Renderer renderer{settings};
+		renderer.init();
+		jobThreads = static_cast<qint64>(renderer.jobThreads());
+		renderer.resize(static_cast<size_t>(size.width()), static_cast<size_t>(size.height()));
+
+		// Animation advances at a fixed rate so runs are comparable. glFinish makes each sample
+		// include the GPU work of its frame.
+		QElapsedTimer timer;
+		for (int frame = 0; frame < warmup + frames; ++frame)
+		{
+			FGL_TRACE_SCOPE("frame");
+
+			timer.start();
+			renderer.render(static_cast<float>(frame) / g_frame_rate, true);
+			{
+				FGL_TRACE_SCOPE("glFinish");
+				functions->glFinish();
+			}
+			if (frame >= warmup)
+			{
+				stats.push(static_cast<float>(timer.nsecsElapsed()) / 1e6f);
+			}
+		}
+
+		// Animation is deterministic, so the last frame of equal runs matches up to rendering differences.
+		lastFrame = fbo.toImage();
+
+		programStats["ms"] = renderer.programTime();
+		programStats["variants"] = static_cast<qint64>(renderer.shaderVariants().size());
+		programStats["cached"] = static_cast<qint64>(renderer.programCache().hits());
+
+		const auto & submit = renderer.submitStats();
+		submitStats["draws"] = static_cast<qint64>(submit.draws);
+		submitStats["binds"] = static_cast<qint64>(submit.binds);
+		submitStats["binds_avoided"] = static_cast<qint64>(submit.bindsAvoided);
+		submitStats["releases_avoided"] = static_cast<qint64>(submit.releasesAvoided);
+
+		// GPU timings lag a few frames behind, the last ones are never read back.
+		const auto & gpuTimer = renderer.gpuTimer();
+		if (gpuTimer.created())
+		{
+			gpuTimes["frame"] = toJson(gpuTimer.frameStats().summary());
+			for (size_t section = 0; section < gpuTimer.sections().size(); ++section)
+			{
+				gpuTimes[gpuTimer.sections()[section]] = toJson(gpuTimer.stats(section).summary());
+			}
+		}
+
+		renderer.destroy();
+		fbo.release();
+	}
+	context.doneCurrent();
+
+	// Report.
+	const auto summary = stats.summary();
+
+	QJsonObject report;
+	report["model"] = settings.modelPath;
+	report["renderer"] = glRenderer;
+	report["load_mode"] = parser.value(loadModeOption);
+	report["morph"] = parser.value(morphOption);
+	report["scene_cache"] = settings.sceneCache;
+	report["culling"] = settings.frustumCulling;
+	report["vertex_format"] = parser.value(vertexFormatOption);
+	report["job_threads"] = jobThreads;
+	report["width"] = size.width();
+	report["height"] = size.height();
+	report["frames"] = frames;
+	report["frame_ms"] = toJson(summary);
+	report["gpu_ms"] = gpuTimes;
+	report["stutters"] = static_cast<qint64>(summary.stutters);
+	report["last_frame"] = submitStats;
+	report["program"] = programStats;
+
+	if (parser.isSet(saveImageOption) && !lastFrame.save(parser.value(saveImageOption)))
+	{
+		qWarning() << "Failed to save" << parser.value(saveImageOption);
+	}
+
+	auto result = 0;
+	if (parser.isSet(diffImageOption))
+	{
+		const auto diff = compareImages(lastFrame, QImage(parser.value(diffImageOption)));
+		const auto minPsnr = parser.value(minPsnrOption).toDouble();
+		if (diff.isEmpty() || (diff.contains("psnr") && diff["psnr"].toDouble() < minPsnr))
+		{
+			result = g_diff_failed;
+		}
+		report["image_diff"] = diff;
+	}
+
+	QTextStream(stdout) << QJsonDocument(report).toJson();
+
+	if (fgl::Trace::enabled() && !fgl::Trace::flush())
+	{
+		qWarning() << "Failed to write trace" << parser.value(traceOption);
+	}
+	return result;
+}
@@ -1,8 +1,13 @@
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QSurfaceFormat>
 
+#include <Base/Trace.hpp>
+
 #include "Window.h"
 
+#include <algorithm>
+
 namespace
 {
 constexpr auto g_sampels = 16;
@@ -16,6 +21,67 @@ int main(int argc, char ** argv)
 	QApplication::setAttribute(Qt::AA_UseDesktopOpenGL);
 	QApplication app(argc, argv);
 
+	// Parse command line.
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	parser.addPositionalArgument("model", "glTF model to show.");
+	const QCommandLineOption loadModeOption("load-mode", "glTF loading mode: mapped or copy.", "mode", "mapped");
+	parser.addOption(loadModeOption);
+	const QCommandLineOption morphOption("morph", "Morph target blending: gpu or cpu.", "mode", "gpu");
+	parser.addOption(morphOption);
+	const QCommandLineOption syncLoadOption("sync-load", "Load the model before the first frame instead of streaming it in.");
+	parser.addOption(syncLoadOption);
+	const QCommandLineOption noCacheOption("no-cache", "Always parse the model, neither read nor write the scene cache.");
+	parser.addOption(noCacheOption);
+	const QCommandLineOption noProgramCacheOption("no-program-cache", "Always compile shaders, neither read nor write program binaries.");
+	parser.addOption(noProgramCacheOption);
+	const QCommandLineOption noCullingOption("no-culling", "Draw every node instead of culling against the view frustum.");
+	parser.addOption(noCullingOption);
+	const QCommandLineOption vertexFormatOption("vertex-format", "Vertex layout of cached scenes: float or quantized.", "format", "float");
+	parser.addOption(vertexFormatOption);
+	const QCommandLineOption renderThreadOption("render-thread", "Render on a dedicated thread, the window only shows finished frames.");
+	parser.addOption(renderThreadOption);
+	const QCommandLineOption clipOption("clip", "Animation of the model to play, the first by default.", "index");
+	parser.addOption(clipOption);
+	const QCommandLineOption jobsOption("jobs", "Worker threads for per-frame CPU work, 0 keeps it on the render thread. One per remaining core by default.", "count");
+	parser.addOption(jobsOption);
+	const QCommandLineOption traceOption("trace", "Record a Chrome trace, written on F12 and at exit.", "file");
+	parser.addOption(traceOption);
+	parser.process(app);
+
+	RenderSettings settings;
+	if (!parser.positionalArguments().isEmpty())
+	{
+		settings.modelPath = parser.positionalArguments().front();
+	}
+	settings.loadMode = parser.value(loadModeOption) == "copy"
+		? GltfAsset::LoadMode::Copy
+		: GltfAsset::LoadMode::Mapped;
+	settings.morphMode = parser.value(morphOption) == "cpu"
+		? GltfScene::MorphMode::Cpu
+		: GltfScene::MorphMode::Gpu;
+	settings.asyncLoading = !parser.isSet(syncLoadOption);
+	settings.sceneCache = !parser.isSet(noCacheOption);
+	settings.programCache = !parser.isSet(noProgramCacheOption);
+	settings.frustumCulling = !parser.isSet(noCullingOption);
+	settings.vertexFormat = parser.value(vertexFormatOption) == "quantized"
+		? SceneCache::VertexFormat::Quantized
+		: SceneCache::VertexFormat::Float;
+	if (parser.isSet(clipOption))
+	{
+		settings.animationClip = static_cast<size_t>(std::max(parser.value(clipOption).toInt(), 0));
+	}
+	if (parser.isSet(jobsOption))
+	{
+		settings.jobWorkers = std::max(parser.value(jobsOption).toInt(), 0);
+	}
+
+	if (parser.isSet(traceOption))
+	{
+		fgl::Trace::setThreadName("main");
+		fgl::Trace::start(parser.value(traceOption).toStdString());
+	}
+
 	// Set default surface format.
 	QSurfaceFormat format;
 	format.setSamples(g_sampels);
@@ -24,9 +90,16 @@ int main(int argc, char ** argv)
 	QSurfaceFormat::setDefaultFormat(format);
 
 	// Now create window.
-	Window window;
+	Window window{settings};
+	window.setThreadedRendering(parser.isSet(renderThreadOption));
 	window.resize(640, 480);
 	window.show();
 
-	return app.exec();
+	const auto result = app.exec();
+
+	if (fgl::Trace::enabled() && !fgl::Trace::flush())
+	{
+		qWarning() << "Failed to write trace" << parser.value(traceOption);
+	}
+	return result;
 }
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "AnimationSampler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Below this angle cosine slerp degenerates, the keys are lerped and normalized instead.
+constexpr float g_slerp_threshold = 0.9995f;
+
+// Fewest curves worth a job of their own.
+constexpr size_t g_curve_grain = 256;
+
+void normalize(float * quaternion) noexcept
+{
+	const auto length = std::sqrt(quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1]
+								  + quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]);
+	if (length > 0.0f)
+	{
+		for (size_t i = 0; i < 4; ++i)
+		{
+			quaternion[i] /= length;
+		}
+	}
+}
+
+void slerp(const float * a, const float * b, const float t, float * out) noexcept
+{
+	// Along the shorter arc.
+	auto cosine = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	const auto sign = cosine < 0.0f ? -1.0f : 1.0f;
+	cosine *= sign;
+
+	auto wa = 1.0f - t;
+	auto wb = t * sign;
+	if (cosine < g_slerp_threshold)
+	{
+		const auto angle = std::acos(cosine);
+		const auto sine = std::sin(angle);
+		wa = std::sin(wa * angle) / sine;
+		wb = std::sin(t * angle) / sine * sign;
+	}
+	for (size_t i = 0; i < 4; ++i)
+	{
+		out[i] = wa * a[i] + wb * b[i];
+	}
+	normalize(out);
+}
+
+}// namespace
+
+std::optional<size_t> AnimationSampler::add(const Curve & curve)
+{
+	const auto keys = curve.times.size();
+	const auto stride = curve.components * (curve.interpolation == Interpolation::CubicSpline ? 3u : 1u);
+	if (keys == 0 || curve.components == 0 || curve.values.size() != keys * stride
+		|| !std::is_sorted(curve.times.begin(), curve.times.end()) || (curve.rotation && curve.components != 4))
+	{
+		return std::nullopt;
+	}
+
+	const auto index = size();
+	firstTimes_.push_back(static_cast<uint32_t>(times_.size()));
+	keyCounts_.push_back(static_cast<uint32_t>(keys));
+	firstValues_.push_back(static_cast<uint32_t>(values_.size()));
+	components_.push_back(curve.components);
+	outputs_.push_back(outputSize_);
+	cursors_.push_back(0);
+	times_.insert(times_.end(), curve.times.begin(), curve.times.end());
+	values_.insert(values_.end(), curve.values.begin(), curve.values.end());
+	outputSize_ += curve.components;
+	duration_ = std::max(duration_, curve.times.back());
+
+	auto group = std::find_if(groups_.begin(), groups_.end(), [&](const Group & group) {
+		return group.interpolation == curve.interpolation && group.components == curve.components
+			&& group.rotation == curve.rotation;
+	});
+	if (group == groups_.end())
+	{
+		group = groups_.insert(groups_.end(), {curve.interpolation, curve.components, curve.rotation, {}});
+	}
+	group->curves.push_back(static_cast<uint32_t>(index));
+	return index;
+}
+
+void AnimationSampler::clear()
+{
+	*this = {};
+}
+
+void AnimationSampler::evaluate(const float time, const std::span<float> out, JobSystem * const jobs)
+{
+	if (out.size() < outputSize_)
+	{
+		return;
+	}
+	for (const auto & group: groups_)
+	{
+		if (!jobs)
+		{
+			searches_ += evaluateRange(group, group.curves, time, out);
+			continue;
+		}
+
+		std::atomic<size_t> searches{0};
+		jobs->parallelFor(group.curves.size(), g_curve_grain, [&](const size_t begin, const size_t end) {
+			const auto found = evaluateRange(group, std::span(group.curves).subspan(begin, end - begin), time, out);
+			searches.fetch_add(found, std::memory_order_relaxed);
+		});
+		searches_ += searches.load(std::memory_order_relaxed);
+	}
+}
+
+size_t AnimationSampler::evaluateRange(const Group & group, const std::span<const uint32_t> curves, const float time,
+									   const std::span<float> out) noexcept
+{
+	switch (group.interpolation)
+	{
+		case Interpolation::Step:
+			return evaluateStep(group, curves, time, out);
+		case Interpolation::Linear:
+			return evaluateLinear(group, curves, time, out);
+		case Interpolation::CubicSpline:
+			return evaluateCubic(group, curves, time, out);
+	}
+	return 0;
+}
+
+uint32_t AnimationSampler::locate(const uint32_t curve, const float time, size_t & searches) noexcept
+{
+	const auto * times = times_.data() + firstTimes_[curve];
+	const auto count = keyCounts_[curve];
+	auto & cursor = cursors_[curve];
+
+	// Playing forward stays in the cached segment or moves to the next one.
+	if (cursor == 0 && time < times[0])
+	{
+		return 0;
+	}
+	if (time >= times[cursor])
+	{
+		if (cursor + 1 >= count || time < times[cursor + 1])
+		{
+			return cursor;
+		}
+		if (cursor + 2 >= count || time < times[cursor + 2])
+		{
+			return ++cursor;
+		}
+	}
+
+	++searches;
+	const auto next = std::upper_bound(times, times + count, time) - times;
+	cursor = next > 0 ? static_cast<uint32_t>(next - 1) : 0;
+	return cursor;
+}
+
+size_t AnimationSampler::evaluateStep(const Group & group, const std::span<const uint32_t> curves, const float time,
+									  const std::span<float> out) noexcept
+{
+	size_t searches = 0;
+	const auto components = group.components;
+	for (const auto curve: curves)
+	{
+		const auto key = locate(curve, time, searches);
+		const auto * value = values_.data() + firstValues_[curve] + size_t{key} * components;
+		std::copy_n(value, components, out.data() + outputs_[curve]);
+	}
+	return searches;
+}
+
+size_t AnimationSampler::evaluateLinear(const Group & group, const std::span<const uint32_t> curves, const float time,
+										const std::span<float> out) noexcept
+{
+	size_t searches = 0;
+	const auto components = group.components;
+	for (const auto curve: curves)
+	{
+		const auto key = locate(curve, time, searches);
+		const auto * times = times_.data() + firstTimes_[curve];
+		const auto * a = values_.data() + firstValues_[curve] + size_t{key} * components;
+		auto * result = out.data() + outputs_[curve];
+
+		// Before the first and after the last key the curve holds still.
+		if (key + 1 >= keyCounts_[curve] || time <= times[key])
+		{
+			std::copy_n(a, components, result);
+			continue;
+		}
+
+		const auto * b = a + components;
+		const auto t = (time - times[key]) / (times[key + 1] - times[key]);
+		if (group.rotation)
+		{
+			slerp(a, b, t, result);
+			continue;
+		}
+		for (uint32_t i = 0; i < components; ++i)
+		{
+			result[i] = a[i] + (b[i] - a[i]) * t;
+		}
+	}
+	return searches;
+}
+
+size_t AnimationSampler::evaluateCubic(const Group & group, const std::span<const uint32_t> curves, const float time,
+									   const std::span<float> out) noexcept
+{
+	size_t searches = 0;
+	const auto components = group.components;
+	const auto stride = size_t{components} * 3;
+	for (const auto curve: curves)
+	{
+		const auto key = locate(curve, time, searches);
+		const auto * times = times_.data() + firstTimes_[curve];
+		// In-tangent, value and out-tangent of the key.
+		const auto * first = values_.data() + firstValues_[curve] + size_t{key} * stride;
+		auto * result = out.data() + outputs_[curve];
+
+		if (key + 1 >= keyCounts_[curve] || time <= times[key])
+		{
+			std::copy_n(first + components, components, result);
+			continue;
+		}
+
+		const auto * second = first + stride;
+		const auto dt = times[key + 1] - times[key];
+		const auto t = (time - times[key]) / dt;
+		const auto t2 = t * t;
+		const auto t3 = t2 * t;
+
+		// Hermite basis, tangents are scaled by the segment length.
+		const auto h00 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+		const auto h10 = (t3 - 2.0f * t2 + t) * dt;
+		const auto h01 = -2.0f * t3 + 3.0f * t2;
+		const auto h11 = (t3 - t2) * dt;
+		for (uint32_t i = 0; i < components; ++i)
+		{
+			result[i] = h00 * first[components + i] + h10 * first[2 * components + i] + h01 * second[components + i]
+				+ h11 * second[i];
+		}
+		if (group.rotation)
+		{
+			normalize(result);
+		}
+	}
+	return searches;
+}
+
+}// namespace fgl
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "JobSystem.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace fgl
+{
+
+enum class Interpolation
+{
+	Step,
+	Linear,
+	// Hermite spline, every key holds an in-tangent, the value and an out-tangent.
+	CubicSpline,
+};
+
+// Keyframe curves evaluated all at once, as glTF animation samplers. Curves are stored
+// structure-of-arrays and grouped by interpolation and value size, so every group is one tight loop.
+// Each curve remembers the segment it was last evaluated in: playing forward finds the next one in
+// O(1), only seeks and loops fall back to a binary search.
+class AnimationSampler final
+{
+public:
+	struct Curve {
+		// Ascending key times in seconds.
+		std::span<const float> times;
+		// `components` floats per key, three times as many for cubic splines.
+		std::span<const float> values;
+		uint32_t components = 1;
+		Interpolation interpolation = Interpolation::Linear;
+		// Quaternions (x, y, z, w): linear keys are slerped, spline results normalized.
+		bool rotation = false;
+	};
+
+	// Copies the keys. Null if times are empty or not ascending, or values do not match them.
+	std::optional<size_t> add(const Curve & curve);
+	void clear();
+
+	[[nodiscard]] size_t size() const noexcept { return components_.size(); }
+	// Where a curve's value starts in the output of evaluate(), and its size.
+	[[nodiscard]] size_t outputOffset(size_t curve) const noexcept { return outputs_[curve]; }
+	[[nodiscard]] uint32_t components(size_t curve) const noexcept { return components_[curve]; }
+	[[nodiscard]] size_t outputSize() const noexcept { return outputSize_; }
+	// Last key time over all curves.
+	[[nodiscard]] float duration() const noexcept { return duration_; }
+
+	// Writes every curve at `time` into `out`, which holds outputSize() floats. Curves are clamped to
+	// their first and last key. Large groups are split across `jobs` when given.
+	void evaluate(float time, std::span<float> out, JobSystem * jobs = nullptr);
+
+	// Evaluations whose cached segment did not fit and had to search.
+	[[nodiscard]] size_t searches() const noexcept { return searches_; }
+
+private:
+	struct Group {
+		Interpolation interpolation;
+		uint32_t components;
+		bool rotation;
+		std::vector<uint32_t> curves;
+	};
+
+	// Key of the segment holding `time`, updating the curve's cursor and counting searches.
+	uint32_t locate(uint32_t curve, float time, size_t & searches) noexcept;
+
+	// A range of a group's curves, returns the searches. Curves only touch their own cursor and output,
+	// so ranges can be evaluated concurrently.
+	size_t evaluateRange(const Group & group, std::span<const uint32_t> curves, float time, std::span<float> out) noexcept;
+	size_t evaluateStep(const Group & group, std::span<const uint32_t> curves, float time, std::span<float> out) noexcept;
+	size_t evaluateLinear(const Group & group, std::span<const uint32_t> curves, float time, std::span<float> out) noexcept;
+	size_t evaluateCubic(const Group & group, std::span<const uint32_t> curves, float time, std::span<float> out) noexcept;
+
+private:
+	// Keys of all curves back to back.
+	std::vector<float> times_;
+	std::vector<float> values_;
+
+	// Per curve.
+	std::vector<uint32_t> firstTimes_;
+	std::vector<uint32_t> keyCounts_;
+	std::vector<uint32_t> firstValues_;
+	std::vector<uint32_t> components_;
+	std::vector<size_t> outputs_;
+	std::vector<uint32_t> cursors_;
+
+	std::vector<Group> groups_;
+	size_t outputSize_ = 0;
+	float duration_ = 0.0f;
+	size_t searches_ = 0;
+};
+
+}// namespace fgl
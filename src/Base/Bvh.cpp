@@ -0,0 +1,350 @@
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <utility>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Fewest items worth culling in parallel, and subtrees to split the tree into per thread.
+constexpr size_t g_parallel_cull_items = 2048;
+constexpr size_t g_subtrees_per_thread = 4;
+
+}// namespace
+
+Aabb Aabb::unbounded() noexcept
+{
+	return {{-g_unbounded, -g_unbounded, -g_unbounded}, {g_unbounded, g_unbounded, g_unbounded}};
+}
+
+void Aabb::grow(const Aabb & other) noexcept
+{
+	for (size_t axis = 0; axis < 3; ++axis)
+	{
+		min[axis] = std::min(min[axis], other.min[axis]);
+		max[axis] = std::max(max[axis], other.max[axis]);
+	}
+}
+
+void Aabb::grow(const float x, const float y, const float z) noexcept
+{
+	grow(Aabb{{x, y, z}, {x, y, z}});
+}
+
+Aabb Aabb::transformed(const std::span<const float, 16> matrix) const noexcept
+{
+	if (empty())
+	{
+		return *this;
+	}
+
+	// Arvo: every matrix element scales either end of the source interval, take the smaller and the larger.
+	Aabb result{{matrix[12], matrix[13], matrix[14]}, {matrix[12], matrix[13], matrix[14]}};
+	for (size_t column = 0; column < 3; ++column)
+	{
+		for (size_t row = 0; row < 3; ++row)
+		{
+			const auto a = matrix[column * 4 + row] * min[column];
+			const auto b = matrix[column * 4 + row] * max[column];
+			result.min[row] += std::min(a, b);
+			result.max[row] += std::max(a, b);
+		}
+	}
+	return result;
+}
+
+Frustum::Frustum(const std::span<const float, 16> viewProjection) noexcept
+{
+	const auto row = [&](const size_t i, const size_t column) {
+		return viewProjection[column * 4 + i];
+	};
+
+	// Left, right, bottom, top, near, far: w + x, w - x, ... >= 0 inside.
+	for (size_t axis = 0; axis < 3; ++axis)
+	{
+		for (size_t side = 0; side < 2; ++side)
+		{
+			auto & plane = planes_[axis * 2 + side];
+			const auto sign = side == 0 ? 1.0f : -1.0f;
+			for (size_t column = 0; column < 4; ++column)
+			{
+				plane[column] = row(3, column) + sign * row(axis, column);
+			}
+		}
+	}
+}
+
+bool Frustum::test(const Aabb & box, uint32_t & mask) const noexcept
+{
+	const std::array<float, 3> center = {(box.min[0] + box.max[0]) * 0.5f, (box.min[1] + box.max[1]) * 0.5f,
+										 (box.min[2] + box.max[2]) * 0.5f};
+	const std::array<float, 3> extent = {(box.max[0] - box.min[0]) * 0.5f, (box.max[1] - box.min[1]) * 0.5f,
+										 (box.max[2] - box.min[2]) * 0.5f};
+
+	for (size_t i = 0; i < planes_.size(); ++i)
+	{
+		const auto bit = 1u << i;
+		if (!(mask & bit))
+		{
+			continue;
+		}
+
+		const auto & plane = planes_[i];
+		const auto distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		const auto radius = std::abs(plane[0]) * extent[0] + std::abs(plane[1]) * extent[1] + std::abs(plane[2]) * extent[2];
+		if (distance + radius < 0.0f)
+		{
+			return false;
+		}
+		if (distance - radius >= 0.0f)
+		{
+			mask &= ~bit;
+		}
+	}
+	return true;
+}
+
+void Bvh::build(const std::span<const Aabb> boxes)
+{
+	clear();
+	if (boxes.empty())
+	{
+		return;
+	}
+
+	boxes_.assign(boxes.begin(), boxes.end());
+	items_.resize(boxes.size());
+	std::iota(items_.begin(), items_.end(), 0u);
+	leaves_.resize(boxes.size());
+
+	nodes_.reserve(2 * (boxes.size() / g_leaf_size + 1));
+	nodes_.push_back({});
+	nodes_.back().count = static_cast<uint32_t>(boxes.size());
+	buildNode(0);
+}
+
+void Bvh::clear()
+{
+	nodes_.clear();
+	items_.clear();
+	leaves_.clear();
+	boxes_.clear();
+}
+
+void Bvh::buildNode(const uint32_t node)
+{
+	const auto first = nodes_[node].first;
+	const auto count = nodes_[node].count;
+	const auto begin = items_.begin() + first;
+	const auto end = begin + count;
+
+	Aabb box;
+	Aabb centers;
+	for (auto it = begin; it != end; ++it)
+	{
+		const auto & item = boxes_[*it];
+		box.grow(item);
+		if (!item.empty())
+		{
+			centers.grow((item.min[0] + item.max[0]) * 0.5f, (item.min[1] + item.max[1]) * 0.5f, (item.min[2] + item.max[2]) * 0.5f);
+		}
+	}
+	nodes_[node].box = box;
+
+	if (count <= g_leaf_size || centers.empty())
+	{
+		for (auto it = begin; it != end; ++it)
+		{
+			leaves_[*it] = node;
+		}
+		return;
+	}
+
+	size_t axis = 0;
+	for (size_t i = 1; i < 3; ++i)
+	{
+		if (centers.max[i] - centers.min[i] > centers.max[axis] - centers.min[axis])
+		{
+			axis = i;
+		}
+	}
+
+	// Empty boxes have no center and go to the far end.
+	const auto center = [&](const uint32_t item) {
+		const auto & bounds = boxes_[item];
+		return bounds.empty() ? std::numeric_limits<float>::max() : bounds.min[axis] + bounds.max[axis];
+	};
+	const auto half = count / 2;
+	std::nth_element(begin, begin + half, end, [&](const uint32_t lhs, const uint32_t rhs) {
+		return center(lhs) < center(rhs);
+	});
+
+	const auto left = static_cast<uint32_t>(nodes_.size());
+	nodes_[node].left = left;
+	nodes_.push_back({{}, 0, node, first, half, false});
+	nodes_.push_back({{}, 0, node, first + half, count - half, false});
+	buildNode(left);
+	buildNode(left + 1);
+}
+
+void Bvh::update(const uint32_t item, const Aabb & box)
+{
+	boxes_[item] = box;
+	// Mark up to the first node that is already marked, the rest of the path is too.
+	auto node = leaves_[item];
+	while (!nodes_[node].dirty)
+	{
+		nodes_[node].dirty = true;
+		if (node == 0)
+		{
+			break;
+		}
+		node = nodes_[node].parent;
+	}
+}
+
+void Bvh::refit()
+{
+	if (!nodes_.empty() && nodes_[0].dirty)
+	{
+		refitNode(0);
+	}
+}
+
+void Bvh::refitNode(const uint32_t node)
+{
+	auto & current = nodes_[node];
+	current.dirty = false;
+
+	Aabb box;
+	if (current.left == 0)
+	{
+		for (auto i = current.first; i < current.first + current.count; ++i)
+		{
+			box.grow(boxes_[items_[i]]);
+		}
+	}
+	else
+	{
+		for (const auto child: {current.left, current.left + 1})
+		{
+			if (nodes_[child].dirty)
+			{
+				refitNode(child);
+			}
+			box.grow(nodes_[child].box);
+		}
+	}
+	nodes_[node].box = box;
+}
+
+void Bvh::cull(const Frustum & frustum, std::vector<uint32_t> & visible) const
+{
+	visible.clear();
+	if (!nodes_.empty())
+	{
+		cullSubtree(frustum, 0, Frustum::g_all_planes, visible);
+	}
+}
+
+void Bvh::cull(const Frustum & frustum, std::vector<uint32_t> & visible, JobSystem & jobs) const
+{
+	if (jobs.threadCount() == 1 || items_.size() < g_parallel_cull_items)
+	{
+		cull(frustum, visible);
+		return;
+	}
+
+	// Split the top levels until there are enough subtrees. Culled ones are dropped on the way, leaves
+	// and subtrees completely inside are kept as they are.
+	const auto target = jobs.threadCount() * g_subtrees_per_thread;
+	std::vector<std::pair<uint32_t, uint32_t>> subtrees{{0, Frustum::g_all_planes}};
+	std::vector<std::pair<uint32_t, uint32_t>> next;
+	auto split = true;
+	while (split && subtrees.size() < target)
+	{
+		split = false;
+		next.clear();
+		for (const auto & [index, parentMask]: subtrees)
+		{
+			const auto & node = nodes_[index];
+			auto mask = parentMask;
+			if (node.box.empty() || !frustum.test(node.box, mask))
+			{
+				continue;
+			}
+			if (mask == 0 || node.left == 0)
+			{
+				next.emplace_back(index, parentMask);
+				continue;
+			}
+			next.emplace_back(node.left, mask);
+			next.emplace_back(node.left + 1, mask);
+			split = true;
+		}
+		subtrees.swap(next);
+	}
+
+	std::vector<std::vector<uint32_t>> partial(subtrees.size());
+	jobs.parallelFor(subtrees.size(), 1, [&](const size_t begin, const size_t end) {
+		for (auto i = begin; i < end; ++i)
+		{
+			cullSubtree(frustum, subtrees[i].first, subtrees[i].second, partial[i]);
+		}
+	});
+
+	visible.clear();
+	for (const auto & items: partial)
+	{
+		visible.insert(visible.end(), items.begin(), items.end());
+	}
+}
+
+void Bvh::cullSubtree(const Frustum & frustum, const uint32_t root, const uint32_t rootMask,
+					  std::vector<uint32_t> & visible) const
+{
+	// Planes a node is inside of are not tested again below it.
+	std::vector<std::pair<uint32_t, uint32_t>> stack;
+	stack.emplace_back(root, rootMask);
+	while (!stack.empty())
+	{
+		const auto [index, parentMask] = stack.back();
+		stack.pop_back();
+
+		const auto & node = nodes_[index];
+		auto mask = parentMask;
+		if (node.box.empty() || !frustum.test(node.box, mask))
+		{
+			continue;
+		}
+
+		const auto begin = items_.begin() + node.first;
+		const auto end = begin + node.count;
+		if (mask == 0)
+		{
+			std::copy_if(begin, end, std::back_inserter(visible), [&](const uint32_t item) {
+				return !boxes_[item].empty();
+			});
+		}
+		else if (node.left == 0)
+		{
+			std::copy_if(begin, end, std::back_inserter(visible), [&](const uint32_t item) {
+				auto itemMask = mask;
+				return !boxes_[item].empty() && frustum.test(boxes_[item], itemMask);
+			});
+		}
+		else
+		{
+			stack.emplace_back(node.left + 1, mask);
+			stack.emplace_back(node.left, mask);
+		}
+	}
+}
+
+}// namespace fgl
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "JobSystem.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace fgl
+{
+
+struct Aabb {
+	// Stands in for infinity, so plane distances stay finite.
+	static constexpr float g_unbounded = 1e30f;
+
+	// Empty by default, growing it by anything yields that.
+	std::array<float, 3> min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+	std::array<float, 3> max{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+	// For things without bounds, never culled.
+	[[nodiscard]] static Aabb unbounded() noexcept;
+
+	[[nodiscard]] bool empty() const noexcept { return min[0] > max[0] || min[1] > max[1] || min[2] > max[2]; }
+	void grow(const Aabb & other) noexcept;
+	void grow(float x, float y, float z) noexcept;
+	// Box around this one transformed by a column-major affine matrix.
+	[[nodiscard]] Aabb transformed(std::span<const float, 16> matrix) const noexcept;
+};
+
+// Clip planes of a column-major view-projection matrix (Gribb and Hartmann), GL depth range.
+class Frustum final
+{
+public:
+	static constexpr uint32_t g_all_planes = 0x3f;
+
+	explicit Frustum(std::span<const float, 16> viewProjection) noexcept;
+
+	// False if the box is outside a plane of `mask`, planes it is completely inside of are cleared from `mask`.
+	[[nodiscard]] bool test(const Aabb & box, uint32_t & mask) const noexcept;
+
+private:
+	std::array<std::array<float, 4>, 6> planes_;
+};
+
+// Bounding volume hierarchy over items with boxes, built top-down with median splits along the longest axis.
+// Moving items are refitted instead of rebuilt: update() marks the path to the root and refit() recomputes
+// only the marked nodes.
+class Bvh final
+{
+public:
+	static constexpr size_t g_leaf_size = 4;
+
+	void build(std::span<const Aabb> boxes);
+	void clear();
+
+	[[nodiscard]] size_t size() const noexcept { return boxes_.size(); }
+	[[nodiscard]] const Aabb & box(uint32_t item) const { return boxes_[item]; }
+
+	// Takes effect on the next refit().
+	void update(uint32_t item, const Aabb & box);
+	void refit();
+
+	// Items whose box is not outside the frustum, in no particular order. Requires a refitted tree.
+	void cull(const Frustum & frustum, std::vector<uint32_t> & visible) const;
+	// The same with the subtrees below the top levels culled as jobs. Small trees are culled right away.
+	void cull(const Frustum & frustum, std::vector<uint32_t> & visible, JobSystem & jobs) const;
+
+private:
+	struct Node {
+		Aabb box;
+		// Children are left and left + 1, a leaf has no left child as the root is nobody's child.
+		uint32_t left = 0;
+		uint32_t parent = 0;
+		// Items of the subtree, a range of items_.
+		uint32_t first = 0;
+		uint32_t count = 0;
+		bool dirty = false;
+	};
+
+	void buildNode(uint32_t node);
+	void refitNode(uint32_t node);
+	// Appends the visible items below `node`, whose parent was inside the planes missing from `mask`.
+	void cullSubtree(const Frustum & frustum, uint32_t node, uint32_t mask, std::vector<uint32_t> & visible) const;
+
+private:
+	std::vector<Node> nodes_;
+	std::vector<uint32_t> items_;
+	std::vector<uint32_t> leaves_;
+	std::vector<Aabb> boxes_;
+};
+
+}// namespace fgl
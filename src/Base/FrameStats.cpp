@@ -0,0 +1,100 @@
+#include "FrameStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace fgl
+{
+
+namespace
+{
+
+// A stutter is a frame twice as long as the moving average and at least a quarter of a 60 Hz frame longer.
+constexpr float g_stutter_factor = 2.0f;
+constexpr float g_stutter_min_excess_ms = 4.0f;
+constexpr float g_average_smoothing = 0.1f;
+
+// Nearest-rank percentile of sorted samples.
+float percentile(const std::vector<float> & sorted, const double rank)
+{
+	const auto index = static_cast<size_t>(std::ceil(rank / 100.0 * static_cast<double>(sorted.size())));
+	return sorted[std::clamp<size_t>(index, 1, sorted.size()) - 1];
+}
+
+}// namespace
+
+FrameStats::FrameStats(const size_t capacity)
+	: capacity_{std::max<size_t>(capacity, 1)}
+	, samples_{std::make_unique<std::atomic<float>[]>(capacity_)}
+{
+}
+
+void FrameStats::push(const float milliseconds) noexcept
+{
+	const auto written = written_.load(std::memory_order_relaxed);
+	samples_[written % capacity_].store(milliseconds, std::memory_order_relaxed);
+	written_.store(written + 1, std::memory_order_release);
+
+	if (milliseconds > worstEver_.load(std::memory_order_relaxed))
+	{
+		worstEver_.store(milliseconds, std::memory_order_relaxed);
+	}
+
+	if (written == 0)
+	{
+		average_ = milliseconds;
+		return;
+	}
+	if (milliseconds > average_ * g_stutter_factor && milliseconds - average_ > g_stutter_min_excess_ms)
+	{
+		stutters_.fetch_add(1, std::memory_order_relaxed);
+	}
+	average_ += (milliseconds - average_) * g_average_smoothing;
+}
+
+void FrameStats::reset() noexcept
+{
+	written_.store(0, std::memory_order_release);
+	worstEver_.store(0.0f, std::memory_order_relaxed);
+	stutters_.store(0, std::memory_order_relaxed);
+	average_ = 0.0f;
+}
+
+std::vector<float> FrameStats::samples() const
+{
+	const auto written = written_.load(std::memory_order_acquire);
+	const auto count = static_cast<size_t>(std::min<uint64_t>(written, capacity_));
+
+	std::vector<float> result(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		result[i] = samples_[(written - count + i) % capacity_].load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+FrameSummary FrameStats::summary() const
+{
+	FrameSummary summary;
+	summary.total = written_.load(std::memory_order_acquire);
+	summary.worstEver = worstEver_.load(std::memory_order_relaxed);
+	summary.stutters = stutters_.load(std::memory_order_relaxed);
+
+	auto sorted = samples();
+	if (sorted.empty())
+	{
+		return summary;
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	summary.frames = sorted.size();
+	summary.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0f) / static_cast<float>(sorted.size());
+	summary.p50 = percentile(sorted, 50.0);
+	summary.p95 = percentile(sorted, 95.0);
+	summary.p99 = percentile(sorted, 99.0);
+	summary.worst = sorted.back();
+	return summary;
+}
+
+}// namespace fgl
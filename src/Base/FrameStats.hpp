@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fgl
+{
+
+struct FrameSummary {
+	// Frames in the rolling window and frames pushed since the last reset.
+	size_t frames = 0;
+	uint64_t total = 0;
+
+	// Milliseconds over the rolling window.
+	float mean = 0.0f;
+	float p50 = 0.0f;
+	float p95 = 0.0f;
+	float p99 = 0.0f;
+	float worst = 0.0f;
+
+	// Since the last reset.
+	float worstEver = 0.0f;
+	uint64_t stutters = 0;
+};
+
+// Rolling per-frame timings. One thread pushes, any thread may read a summary without locking;
+// a reader racing the writer may see a sample of the next frame in place of the oldest one.
+class FrameStats final
+{
+public:
+	explicit FrameStats(size_t capacity = 512);
+
+	FrameStats(const FrameStats &) = delete;
+	FrameStats(FrameStats &&) = delete;
+
+	FrameStats & operator=(const FrameStats &) = delete;
+	FrameStats & operator=(FrameStats &&) = delete;
+
+	[[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+
+	// Writer side.
+	void push(float milliseconds) noexcept;
+	void reset() noexcept;
+
+	// Reader side. Samples of the rolling window, oldest first.
+	[[nodiscard]] std::vector<float> samples() const;
+	[[nodiscard]] FrameSummary summary() const;
+
+private:
+	size_t capacity_;
+	std::unique_ptr<std::atomic<float>[]> samples_;
+	std::atomic<uint64_t> written_{0};
+	std::atomic<float> worstEver_{0.0f};
+	std::atomic<uint64_t> stutters_{0};
+
+	// Moving average a stutter is measured against, only touched by the writer.
+	float average_ = 0.0f;
+};
+
+}// namespace fgl
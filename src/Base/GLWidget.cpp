@@ -1,5 +1,8 @@
 #include "GLWidget.hpp"
 
+#include "RenderThread.hpp"
+#include "Trace.hpp"
+
 namespace fgl
 {
 
@@ -14,15 +17,60 @@ GLWidget::ContextGuard::~ContextGuard()
 	self_.doneCurrent();
 }
 
+GLWidget::GLWidget(QWidget * parent)
+	: QOpenGLWidget(parent)
+{
+}
+
+GLWidget::~GLWidget() = default;
+
 auto GLWidget::bindContext() noexcept -> ContextGuard
 {
 	return ContextGuard{*this};
 }
 
+void GLWidget::requestFrame()
+{
+	if (renderThread_)
+	{
+		renderThread_->requestFrame();
+		return;
+	}
+	update();
+}
+
+void GLWidget::stopRendering()
+{
+	if (renderThread_)
+	{
+		const auto guard = bindContext();
+		renderThread_->stop();
+		renderThread_.reset();
+		return;
+	}
+
+	const auto guard = bindContext();
+	onDestroy();
+}
+
 void GLWidget::initializeGL()
 {
+	FGL_TRACE_SCOPE("GLWidget::initializeGL");
+
 	initializeOpenGLFunctions();
 
+	if (threaded_)
+	{
+		renderThread_ = std::make_unique<RenderThread>(*this, [this] {
+			if (!repaintPending_.exchange(true))
+			{
+				QMetaObject::invokeMethod(this, [this] { update(); }, Qt::QueuedConnection);
+			}
+		});
+		renderThread_->start();
+		return;
+	}
+
 	{
 		const auto guard = bindContext();
 		onInit();
@@ -32,12 +80,29 @@ void GLWidget::initializeGL()
 void GLWidget::resizeGL(const int width, const int height)
 {
 	const auto retinaScale = devicePixelRatio();
-	onResize(static_cast<size_t>(width * retinaScale),
-			 static_cast<size_t>((height ? height : 1) * retinaScale));
+	width_ = static_cast<size_t>(width * retinaScale);
+	height_ = static_cast<size_t>((height ? height : 1) * retinaScale);
+	if (renderThread_)
+	{
+		renderThread_->resize(width_, height_);
+		return;
+	}
+	onResize(width_, height_);
 }
 
 void GLWidget::paintGL()
 {
+	FGL_TRACE_SCOPE("GLWidget::paintGL");
+
+	if (renderThread_)
+	{
+		repaintPending_ = false;
+		if (!renderThread_->present(defaultFramebufferObject(), width_, height_))
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+		}
+		return;
+	}
 	onRender();
 }
 
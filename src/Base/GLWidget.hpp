@@ -3,22 +3,39 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLWidget>
 
+#include <atomic>
+#include <memory>
+
 namespace fgl
 {
 
+class RenderThread;
+
 class GLWidget : public QOpenGLWidget
 	, protected QOpenGLFunctions
 {
 	Q_OBJECT
 
 public:
-	using QOpenGLWidget::QOpenGLWidget;
-	virtual ~GLWidget() = default;
+	explicit GLWidget(QWidget * parent = nullptr);
+	~GLWidget() override;
 
 public:
 	virtual void onInit() = 0;
 	virtual void onRender() = 0;
 	virtual void onResize(size_t width, size_t height) = 0;
+	// Frees what onInit() created, called by stopRendering() with the same context current.
+	virtual void onDestroy() = 0;
+
+	// Set before the widget is shown. The callbacks then run on a render thread with a context of its own
+	// and paintGL() only blits the newest finished frame, so GUI work never holds up a frame.
+	void setThreadedRendering(bool enabled) noexcept { threaded_ = enabled; }
+	[[nodiscard]] bool threadedRendering() const noexcept { return threaded_; }
+
+	// Schedules another onRender(), callable from onRender().
+	void requestFrame();
+	// Calls onDestroy(), derived destructors must call this while the derived part is alive.
+	void stopRendering();
 
 public:
 	class ContextGuard final
@@ -42,6 +59,14 @@ private:// QOpenGLWidget
 	void initializeGL() override;
 	void resizeGL(int width, int height) override;
 	void paintGL() override;
+
+private:
+	bool threaded_ = false;
+	std::unique_ptr<RenderThread> renderThread_;
+	// Set while a repaint for a new frame is queued, frames finished meanwhile are picked up by it.
+	std::atomic<bool> repaintPending_{false};
+	size_t width_ = 0;
+	size_t height_ = 0;
 };
 
 }// namespace fgl
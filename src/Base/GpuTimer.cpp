@@ -0,0 +1,123 @@
+#include "GpuTimer.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace fgl
+{
+
+GpuTimer::GpuTimer(std::vector<QString> sections, const size_t capacity)
+	: sections_{std::move(sections)}
+	, frameStats_{capacity}
+{
+	for (size_t i = 0; i < sections_.size(); ++i)
+	{
+		sectionStats_.push_back(std::make_unique<FrameStats>(capacity));
+	}
+}
+
+bool GpuTimer::create()
+{
+	destroy();
+
+	for (auto & slot: slots_)
+	{
+		slot.monitor = std::make_unique<QOpenGLTimeMonitor>();
+		slot.monitor->setSampleCount(static_cast<int>(sections_.size() + 1));
+		if (!slot.monitor->create())
+		{
+			destroy();
+			return false;
+		}
+		slot.order.reserve(sections_.size());
+	}
+
+	created_ = true;
+	return true;
+}
+
+void GpuTimer::destroy()
+{
+	for (auto & slot: slots_)
+	{
+		slot.monitor.reset();
+		slot.order.clear();
+		slot.pending = false;
+	}
+	frame_ = 0;
+	recording_ = false;
+	created_ = false;
+}
+
+void GpuTimer::beginFrame()
+{
+	if (!created_)
+	{
+		return;
+	}
+
+	// Reuse the oldest set, its queries were issued g_latency frames ago.
+	auto & slot = slots_[frame_ % g_latency];
+	if (slot.pending)
+	{
+		if (slot.monitor->isResultAvailable())
+		{
+			resolve(slot);
+		}
+		else
+		{
+			++dropped_;
+		}
+		slot.monitor->reset();
+		slot.pending = false;
+	}
+
+	slot.order.clear();
+	slot.monitor->recordSample();
+	recording_ = true;
+}
+
+void GpuTimer::endSection(const size_t section)
+{
+	auto & slot = slots_[frame_ % g_latency];
+	if (!recording_ || section >= sections_.size() || slot.order.size() == sections_.size())
+	{
+		return;
+	}
+
+	slot.monitor->recordSample();
+	slot.order.push_back(section);
+}
+
+void GpuTimer::endFrame()
+{
+	if (!recording_)
+	{
+		return;
+	}
+
+	slots_[frame_ % g_latency].pending = true;
+	recording_ = false;
+	++frame_;
+}
+
+void GpuTimer::resolve(Slot & slot)
+{
+	// Available results make this a plain read.
+	const auto intervals = slot.monitor->waitForIntervals();
+	const auto count = std::min(static_cast<size_t>(intervals.size()), slot.order.size());
+
+	std::vector<float> sectionTimes(sections_.size(), 0.0f);
+	for (size_t i = 0; i < count; ++i)
+	{
+		sectionTimes[slot.order[i]] += static_cast<float>(intervals[static_cast<int>(i)]) / 1e6f;
+	}
+
+	for (size_t i = 0; i < sections_.size(); ++i)
+	{
+		sectionStats_[i]->push(sectionTimes[i]);
+	}
+	frameStats_.push(std::accumulate(sectionTimes.begin(), sectionTimes.end(), 0.0f));
+}
+
+}// namespace fgl
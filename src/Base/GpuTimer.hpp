@@ -0,0 +1,69 @@
+#pragma once
+
+#include "FrameStats.hpp"
+
+#include <QOpenGLTimeMonitor>
+#include <QString>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fgl
+{
+
+// GPU time of consecutive named sections of a frame, measured with timestamp queries.
+// Query sets rotate over g_latency frames and are read back only once available, so measuring
+// never stalls the pipeline; a set still pending when its turn comes again is dropped.
+class GpuTimer final
+{
+public:
+	static constexpr size_t g_latency = 3;
+
+	explicit GpuTimer(std::vector<QString> sections, size_t capacity = 512);
+
+	GpuTimer(const GpuTimer &) = delete;
+	GpuTimer(GpuTimer &&) = delete;
+
+	GpuTimer & operator=(const GpuTimer &) = delete;
+	GpuTimer & operator=(GpuTimer &&) = delete;
+
+	// Require a current context. create() fails if the context has no timer queries.
+	bool create();
+	void destroy();
+	[[nodiscard]] bool created() const noexcept { return created_; }
+
+	// A section starts where the previous one, or the frame, ended.
+	void beginFrame();
+	void endSection(size_t section);
+	void endFrame();
+
+	[[nodiscard]] const std::vector<QString> & sections() const noexcept { return sections_; }
+	[[nodiscard]] const FrameStats & stats(size_t section) const { return *sectionStats_[section]; }
+	[[nodiscard]] const FrameStats & frameStats() const noexcept { return frameStats_; }
+	[[nodiscard]] uint64_t dropped() const noexcept { return dropped_; }
+
+private:
+	struct Slot {
+		std::unique_ptr<QOpenGLTimeMonitor> monitor;
+		// Section of every recorded interval.
+		std::vector<size_t> order;
+		bool pending = false;
+	};
+
+	void resolve(Slot & slot);
+
+private:
+	std::vector<QString> sections_;
+	std::vector<std::unique_ptr<FrameStats>> sectionStats_;
+	FrameStats frameStats_;
+
+	std::array<Slot, g_latency> slots_;
+	size_t frame_ = 0;
+	bool recording_ = false;
+	bool created_ = false;
+	uint64_t dropped_ = 0;
+};
+
+}// namespace fgl
@@ -0,0 +1,70 @@
+#include "Hash.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr uint64_t g_prime1 = 0x9e3779b185ebca87ull;
+constexpr uint64_t g_prime2 = 0xc2b2ae3d27d4eb4full;
+constexpr uint64_t g_prime3 = 0x165667b19e3779f9ull;
+
+uint64_t read64(const std::byte * bytes) noexcept
+{
+	uint64_t value = 0;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+uint64_t mix(const uint64_t acc, const uint64_t input) noexcept
+{
+	return std::rotl(acc + input * g_prime2, 31) * g_prime1;
+}
+
+uint64_t avalanche(uint64_t hash) noexcept
+{
+	hash ^= hash >> 33;
+	hash *= g_prime2;
+	hash ^= hash >> 29;
+	hash *= g_prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+}// namespace
+
+uint64_t hash64(const std::span<const std::byte> bytes, const uint64_t seed) noexcept
+{
+	const auto * data = bytes.data();
+	auto size = bytes.size();
+
+	std::array<uint64_t, 4> lanes = {seed + g_prime1 + g_prime2, seed + g_prime2, seed, seed - g_prime1};
+	for (; size >= 32; data += 32, size -= 32)
+	{
+		for (size_t lane = 0; lane < lanes.size(); ++lane)
+		{
+			lanes[lane] = mix(lanes[lane], read64(data + lane * 8));
+		}
+	}
+
+	auto hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+	hash = mix(hash, bytes.size());
+	for (; size >= 8; data += 8, size -= 8)
+	{
+		hash = mix(hash, read64(data));
+	}
+	if (size > 0)
+	{
+		uint64_t tail = 0;
+		std::memcpy(&tail, data, size);
+		hash = mix(hash, tail ^ (uint64_t{size} << 56));
+	}
+	return avalanche(hash);
+}
+
+}// namespace fgl
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace fgl
+{
+
+// Fast non-cryptographic 64-bit hash for cache keys. Reads four independent 64-bit lanes so large
+// inputs run at memory speed; results are only stable on the same byte order.
+[[nodiscard]] uint64_t hash64(std::span<const std::byte> bytes, uint64_t seed = 0) noexcept;
+
+}// namespace fgl
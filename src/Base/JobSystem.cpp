@@ -0,0 +1,183 @@
+#include "JobSystem.hpp"
+
+#include "Trace.hpp"
+
+namespace fgl
+{
+
+namespace
+{
+
+// Set on worker threads, so nested jobs go to the worker's own deque.
+struct CurrentWorker {
+	const JobSystem * system = nullptr;
+	size_t index = 0;
+};
+
+thread_local CurrentWorker t_worker;
+
+}// namespace
+
+size_t JobSystem::defaultWorkers() noexcept
+{
+	const auto cores = std::thread::hardware_concurrency();
+	return cores > 1 ? cores - 1 : 0;
+}
+
+JobSystem::JobSystem(const size_t workers)
+{
+	for (size_t i = 0; i <= workers; ++i)
+	{
+		deques_.push_back(std::make_unique<Deque>());
+	}
+	for (size_t i = 1; i <= workers; ++i)
+	{
+		threads_.emplace_back([this, i] { work(i); });
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	stopping_.store(true, std::memory_order_release);
+	queued_.fetch_add(1, std::memory_order_release);
+	queued_.notify_all();
+	for (auto & thread: threads_)
+	{
+		thread.join();
+	}
+
+	// Jobs nobody waited for.
+	Job * job = nullptr;
+	for (auto & deque: deques_)
+	{
+		while (deque->pop(job))
+		{
+			delete job;
+		}
+	}
+}
+
+void JobSystem::run(Function function, JobCounter * const counter, JobCounter * const after)
+{
+	auto * job = new Job{std::move(function), counter};
+	if (counter)
+	{
+		counter->pending_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (after)
+	{
+		const std::lock_guard lock(after->mutex_);
+		if (!after->done())
+		{
+			after->dependents_.push_back(job);
+			return;
+		}
+	}
+	push(job);
+}
+
+void JobSystem::wait(JobCounter & counter)
+{
+	const auto thread = threadIndex();
+	while (!counter.done())
+	{
+		if (auto * job = next(thread))
+		{
+			execute(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// The job that finished last may still hold the lock.
+	const std::lock_guard lock(counter.mutex_);
+}
+
+size_t JobSystem::threadIndex() const noexcept
+{
+	return t_worker.system == this ? t_worker.index : 0;
+}
+
+void JobSystem::push(Job * const job)
+{
+	if (!deques_[threadIndex()]->push(job))
+	{
+		// Full, nobody is keeping up anyway.
+		execute(job);
+		return;
+	}
+	queued_.fetch_add(1, std::memory_order_release);
+	queued_.notify_one();
+}
+
+JobSystem::Job * JobSystem::next(const size_t thread) noexcept
+{
+	Job * job = nullptr;
+	if (deques_[thread]->pop(job))
+	{
+		queued_.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	// Victims in turn, starting after the own deque so thieves spread out.
+	for (size_t i = 1; i < deques_.size(); ++i)
+	{
+		if (deques_[(thread + i) % deques_.size()]->steal(job))
+		{
+			queued_.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::execute(Job * const job)
+{
+	job->function();
+	auto * const counter = job->counter;
+	delete job;
+	if (!counter)
+	{
+		return;
+	}
+
+	std::vector<void *> dependents;
+	{
+		const std::lock_guard lock(counter->mutex_);
+		if (counter->pending_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		{
+			return;
+		}
+		dependents.swap(counter->dependents_);
+	}
+	for (auto * dependent: dependents)
+	{
+		push(static_cast<Job *>(dependent));
+	}
+}
+
+void JobSystem::work(const size_t thread)
+{
+	t_worker = {this, thread};
+	Trace::setThreadName("job worker");
+
+	while (true)
+	{
+		if (auto * job = next(thread))
+		{
+			execute(job);
+			continue;
+		}
+		if (stopping_.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		// Sleeps until a job is pushed, returns at once if one was since the last look.
+		queued_.wait(0, std::memory_order_acquire);
+	}
+}
+
+}// namespace fgl
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "WorkStealingDeque.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fgl
+{
+
+// Jobs started with a counter that have not finished yet. Other jobs can be held back until a counter
+// reaches zero, and JobSystem::wait() runs jobs until it does.
+class JobCounter final
+{
+public:
+	JobCounter() = default;
+
+	JobCounter(const JobCounter &) = delete;
+	JobCounter(JobCounter &&) = delete;
+
+	JobCounter & operator=(const JobCounter &) = delete;
+	JobCounter & operator=(JobCounter &&) = delete;
+
+	[[nodiscard]] bool done() const noexcept { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> pending_{0};
+	// Guards the last decrement, so the counter can be destroyed as soon as wait() returns.
+	std::mutex mutex_;
+	// Jobs that start once the counter reaches zero.
+	std::vector<void *> dependents_;
+};
+
+// Worker threads with a Chase-Lev deque each. A thread pushes and pops jobs at the bottom of its own
+// deque and steals from the top of the others' once it runs dry; idle workers sleep until a job is pushed.
+// Jobs are started from the workers and from one other thread at a time, usually the render thread. That
+// thread has a deque of its own and runs jobs while it waits, so nothing blocks with no workers at all.
+class JobSystem final
+{
+public:
+	using Function = std::function<void()>;
+
+	// One worker per core besides the calling thread's.
+	[[nodiscard]] static size_t defaultWorkers() noexcept;
+
+	explicit JobSystem(size_t workers = defaultWorkers());
+	~JobSystem();
+
+	JobSystem(const JobSystem &) = delete;
+	JobSystem(JobSystem &&) = delete;
+
+	JobSystem & operator=(const JobSystem &) = delete;
+	JobSystem & operator=(JobSystem &&) = delete;
+
+	// Threads running jobs: the workers and the thread starting them.
+	[[nodiscard]] size_t threadCount() const noexcept { return deques_.size(); }
+
+	// Runs `function` on any thread. It is counted by `counter` until it returns and does not start before
+	// `after` reached zero.
+	void run(Function function, JobCounter * counter = nullptr, JobCounter * after = nullptr);
+	// Runs jobs until `counter` reaches zero.
+	void wait(JobCounter & counter);
+
+	// Calls function(begin, end) for chunks of [0, count), at least `grain` elements each, and returns once
+	// all are done. There are a few chunks per thread, so stealing evens out chunks of uneven cost; the
+	// calling thread takes the first one and ranges of a single chunk never leave it.
+	template<typename Range>
+	void parallelFor(size_t count, size_t grain, const Range & function);
+
+private:
+	static constexpr size_t g_deque_capacity = 4096;
+	static constexpr size_t g_chunks_per_thread = 4;
+
+	struct Job {
+		Function function;
+		JobCounter * counter = nullptr;
+	};
+
+	using Deque = WorkStealingDeque<Job *, g_deque_capacity>;
+
+	// Deque of the current thread, 0 for any thread that is not a worker.
+	[[nodiscard]] size_t threadIndex() const noexcept;
+
+	void push(Job * job);
+	// Own jobs first, then stolen ones.
+	Job * next(size_t thread) noexcept;
+	void execute(Job * job);
+	void work(size_t thread);
+
+private:
+	std::vector<std::unique_ptr<Deque>> deques_;
+	std::vector<std::thread> threads_;
+	// Jobs in the deques, workers sleep on it while it is zero.
+	std::atomic<uint32_t> queued_{0};
+	std::atomic<bool> stopping_{false};
+};
+
+template<typename Range>
+void JobSystem::parallelFor(const size_t count, const size_t grain, const Range & function)
+{
+	const auto chunks = threadCount() * g_chunks_per_thread;
+	const auto chunk = std::max({grain, size_t{1}, (count + chunks - 1) / chunks});
+	if (count <= chunk)
+	{
+		if (count > 0)
+		{
+			function(size_t{0}, count);
+		}
+		return;
+	}
+
+	JobCounter counter;
+	for (auto begin = chunk; begin < count; begin += chunk)
+	{
+		const auto end = std::min(begin + chunk, count);
+		run([&function, begin, end] { function(begin, end); }, &counter);
+	}
+	function(size_t{0}, chunk);
+	wait(counter);
+}
+
+}// namespace fgl
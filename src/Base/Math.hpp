@@ -0,0 +1,63 @@
+#pragma once
+
+// Per-frame matrix math on glm's aligned types. The Base target defines GLM_FORCE_INTRINSICS, so products
+// of these go through glm's SSE or NEON code; QMatrix4x4 stays for load-time work only.
+#if defined(_MSC_VER)
+#pragma warning(push)
+// glm's vector types are unions of anonymous structs.
+#pragma warning(disable : 4201)
+#endif
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/type_aligned.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/trigonometric.hpp>
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+#include <span>
+
+namespace fgl
+{
+
+using Vec3 = glm::aligned_vec3;
+using Vec4 = glm::aligned_vec4;
+// Column-major, like GL.
+using Mat4 = glm::aligned_mat4;
+
+// Vertical field of view in degrees and GL depth range, as QMatrix4x4::perspective.
+[[nodiscard]] inline Mat4 perspective(const float fov, const float aspect, const float zNear, const float zFar) noexcept
+{
+	return Mat4(glm::perspective(glm::radians(fov), aspect, zNear, zFar));
+}
+
+[[nodiscard]] inline Mat4 lookAt(const Vec3 & eye, const Vec3 & center, const Vec3 & up) noexcept
+{
+	return glm::lookAt(eye, center, up);
+}
+
+[[nodiscard]] inline Mat4 translation(const Vec3 & offset) noexcept
+{
+	return glm::translate(Mat4(1.0f), offset);
+}
+
+// The 16 column-major elements, for GL calls and fgl::Frustum.
+[[nodiscard]] inline std::span<const float, 16> elements(const Mat4 & matrix) noexcept
+{
+	return std::span<const float, 16>(glm::value_ptr(matrix), 16);
+}
+
+[[nodiscard]] inline Mat4 fromElements(const std::span<const float, 16> values) noexcept
+{
+	return Mat4(glm::make_mat4(values.data()));
+}
+
+// A point transformed by an affine matrix.
+[[nodiscard]] inline Vec3 transformPoint(const Mat4 & matrix, const Vec3 & point) noexcept
+{
+	return Vec3(matrix * Vec4(point, 1.0f));
+}
+
+}// namespace fgl
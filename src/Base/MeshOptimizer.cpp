@@ -0,0 +1,371 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr auto g_none = std::numeric_limits<size_t>::max();
+constexpr auto g_unused = std::numeric_limits<uint32_t>::max();
+
+using Vector = std::array<double, 3>;
+
+// FIFO cache as insertion stamps: a vertex is cached while fewer than `size` others were inserted after it.
+class CacheSimulator
+{
+public:
+	CacheSimulator(const size_t vertexCount, const size_t size)
+		: stamps_(vertexCount, 0)
+		, size_{size}
+		, time_{size + 1}
+	{
+	}
+
+	// True on a miss, which inserts the vertex.
+	bool access(const uint32_t vertex) noexcept
+	{
+		if (time_ - stamps_[vertex] <= size_)
+		{
+			return false;
+		}
+		stamps_[vertex] = time_++;
+		return true;
+	}
+
+	[[nodiscard]] size_t age(const uint32_t vertex) const noexcept { return time_ - stamps_[vertex]; }
+
+	// Everything inserted so far is evicted.
+	void flush() noexcept { time_ += size_ + 1; }
+
+private:
+	std::vector<size_t> stamps_;
+	size_t size_;
+	size_t time_;
+};
+
+}// namespace
+
+float VertexCacheStats::acmr() const noexcept
+{
+	return triangles > 0 ? static_cast<float>(transformed) / static_cast<float>(triangles) : 0.0f;
+}
+
+float VertexCacheStats::atvr() const noexcept
+{
+	return vertices > 0 ? static_cast<float>(transformed) / static_cast<float>(vertices) : 0.0f;
+}
+
+VertexCacheStats & VertexCacheStats::operator+=(const VertexCacheStats & other) noexcept
+{
+	transformed += other.transformed;
+	triangles += other.triangles;
+	vertices += other.vertices;
+	return *this;
+}
+
+MeshOptimizer::MeshOptimizer(const size_t cacheSize) noexcept
+	: cacheSize_{std::max(cacheSize, size_t{3})}
+{
+}
+
+VertexCacheStats MeshOptimizer::analyze(const std::span<const uint32_t> indices, const size_t vertexCount) const
+{
+	VertexCacheStats stats;
+	stats.triangles = indices.size() / 3;
+
+	CacheSimulator cache(vertexCount, cacheSize_);
+	std::vector<bool> used(vertexCount, false);
+	for (const auto index: indices.first(stats.triangles * 3))
+	{
+		stats.transformed += cache.access(index) ? 1 : 0;
+		stats.vertices += used[index] ? 0 : 1;
+		used[index] = true;
+	}
+	return stats;
+}
+
+void MeshOptimizer::reorderTriangles(const std::span<uint32_t> indices, const std::span<const float> positions,
+									 const size_t stride) const
+{
+	const auto triangles = indices.size() / 3;
+	const auto vertexCount = stride >= 3 ? positions.size() / stride : 0;
+	if (triangles < 2 || vertexCount == 0)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> order;
+	std::vector<size_t> clusters;
+	tipsify(indices, vertexCount, order, clusters);
+	splitClusters(indices, order, vertexCount, clusters);
+	clusters.push_back(triangles);
+
+	// Area-weighted centroid and normal of every cluster, the normal is left unnormalized.
+	const auto position = [&](const uint32_t vertex) -> Vector {
+		const auto * xyz = positions.data() + vertex * stride;
+		return {xyz[0], xyz[1], xyz[2]};
+	};
+
+	std::vector<Vector> centroids(clusters.size() - 1, Vector{});
+	std::vector<Vector> normals(clusters.size() - 1, Vector{});
+	std::vector<double> areas(clusters.size() - 1, 0.0);
+	Vector meshCentroid{};
+	double meshArea = 0.0;
+	for (size_t cluster = 0; cluster + 1 < clusters.size(); ++cluster)
+	{
+		for (auto i = clusters[cluster]; i < clusters[cluster + 1]; ++i)
+		{
+			const auto * triangle = indices.data() + order[i] * 3;
+			const auto a = position(triangle[0]);
+			const auto b = position(triangle[1]);
+			const auto c = position(triangle[2]);
+
+			const Vector ab = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+			const Vector ac = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+			const Vector normal = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+			const auto area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				const auto center = (a[axis] + b[axis] + c[axis]) / 3.0;
+				centroids[cluster][axis] += center * area;
+				meshCentroid[axis] += center * area;
+				normals[cluster][axis] += normal[axis];
+			}
+			areas[cluster] += area;
+			meshArea += area;
+		}
+	}
+
+	// Clusters facing away from the mesh center are likely in front of the rest from any direction.
+	std::vector<double> facing(clusters.size() - 1, 0.0);
+	for (size_t cluster = 0; cluster < facing.size(); ++cluster)
+	{
+		const auto & normal = normals[cluster];
+		const auto length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (areas[cluster] <= 0.0 || length <= 0.0 || meshArea <= 0.0)
+		{
+			continue;
+		}
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			facing[cluster] += (centroids[cluster][axis] / areas[cluster] - meshCentroid[axis] / meshArea) * normal[axis] / length;
+		}
+	}
+
+	std::vector<size_t> sorted(facing.size());
+	std::iota(sorted.begin(), sorted.end(), size_t{0});
+	std::stable_sort(sorted.begin(), sorted.end(), [&](const size_t lhs, const size_t rhs) {
+		return facing[lhs] > facing[rhs];
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(triangles * 3);
+	for (const auto cluster: sorted)
+	{
+		for (auto i = clusters[cluster]; i < clusters[cluster + 1]; ++i)
+		{
+			const auto * triangle = indices.data() + order[i] * 3;
+			result.insert(result.end(), triangle, triangle + 3);
+		}
+	}
+	std::copy(result.begin(), result.end(), indices.begin());
+}
+
+std::vector<uint32_t> MeshOptimizer::reorderVertices(const std::span<uint32_t> indices, const size_t vertexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, g_unused);
+	uint32_t next = 0;
+	for (auto & index: indices)
+	{
+		if (remap[index] == g_unused)
+		{
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+	return remap;
+}
+
+size_t MeshOptimizer::remapVertices(std::vector<float> & vertices, const size_t stride, const std::span<const uint32_t> remap)
+{
+	const auto count = static_cast<size_t>(std::count_if(remap.begin(), remap.end(), [](const uint32_t index) {
+		return index != g_unused;
+	}));
+
+	std::vector<float> result(count * stride);
+	for (size_t vertex = 0; vertex < remap.size(); ++vertex)
+	{
+		if (remap[vertex] != g_unused)
+		{
+			std::copy_n(vertices.data() + vertex * stride, stride, result.data() + remap[vertex] * stride);
+		}
+	}
+	vertices = std::move(result);
+	return count;
+}
+
+void MeshOptimizer::tipsify(const std::span<const uint32_t> indices, const size_t vertexCount,
+							std::vector<uint32_t> & order, std::vector<size_t> & clusters) const
+{
+	const auto triangles = indices.size() / 3;
+
+	// Triangles around every vertex, and how many of them are not emitted yet.
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (const auto index: indices.first(triangles * 3))
+	{
+		++live[index];
+	}
+	std::vector<size_t> offsets(vertexCount + 1, 0);
+	std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+	std::vector<uint32_t> adjacency(triangles * 3);
+	{
+		auto cursor = offsets;
+		for (size_t triangle = 0; triangle < triangles; ++triangle)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				adjacency[cursor[indices[triangle * 3 + corner]]++] = static_cast<uint32_t>(triangle);
+			}
+		}
+	}
+
+	CacheSimulator cache(vertexCount, cacheSize_);
+	std::vector<bool> emitted(triangles, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	size_t cursor = 0;
+
+	// Most recently touched vertex with triangles left, else the next one in index order.
+	const auto skipDeadEnd = [&]() -> size_t {
+		while (!deadEnd.empty())
+		{
+			const auto vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[vertex] > 0)
+			{
+				return vertex;
+			}
+		}
+		for (; cursor < vertexCount; ++cursor)
+		{
+			if (live[cursor] > 0)
+			{
+				return cursor;
+			}
+		}
+		return g_none;
+	};
+
+	order.clear();
+	order.reserve(triangles);
+	clusters.assign(1, 0);
+
+	auto fan = skipDeadEnd();
+	while (fan != g_none)
+	{
+		// Emit every remaining triangle around the fanning vertex.
+		candidates.clear();
+		for (auto i = offsets[fan]; i < offsets[fan + 1]; ++i)
+		{
+			const auto triangle = adjacency[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = true;
+			order.push_back(triangle);
+
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				const auto vertex = indices[triangle * 3 + corner];
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+				cache.access(vertex);
+			}
+		}
+
+		// Continue with the oldest candidate that stays cached while its triangles are emitted.
+		auto next = g_none;
+		std::ptrdiff_t best = -1;
+		for (const auto vertex: candidates)
+		{
+			if (live[vertex] == 0)
+			{
+				continue;
+			}
+			const auto age = cache.age(vertex);
+			const auto priority = age + 2 * live[vertex] <= cacheSize_ ? static_cast<std::ptrdiff_t>(age) : 0;
+			if (priority > best)
+			{
+				best = priority;
+				next = vertex;
+			}
+		}
+
+		if (next == g_none)
+		{
+			next = skipDeadEnd();
+			if (next != g_none && order.size() > clusters.back())
+			{
+				clusters.push_back(order.size());
+			}
+		}
+		fan = next;
+	}
+}
+
+void MeshOptimizer::splitClusters(const std::span<const uint32_t> indices, const std::span<const uint32_t> order,
+								  const size_t vertexCount, std::vector<size_t> & clusters) const
+{
+	// Soft boundaries inside the Tipsify clusters: a cluster is cut wherever the part so far has nearly its
+	// full ACMR, so restarting the cache there costs little.
+	CacheSimulator cache(vertexCount, cacheSize_);
+	const auto misses = [&](const size_t i) {
+		const auto * triangle = indices.data() + order[i] * 3;
+		return size_t{cache.access(triangle[0])} + cache.access(triangle[1]) + cache.access(triangle[2]);
+	};
+
+	std::vector<size_t> result;
+	result.reserve(clusters.size());
+	for (size_t cluster = 0; cluster < clusters.size(); ++cluster)
+	{
+		const auto begin = clusters[cluster];
+		const auto end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : order.size();
+
+		cache.flush();
+		size_t clusterMisses = 0;
+		for (auto i = begin; i < end; ++i)
+		{
+			clusterMisses += misses(i);
+		}
+		const auto threshold = static_cast<float>(clusterMisses) / static_cast<float>(end - begin) * g_overdraw_threshold;
+
+		cache.flush();
+		result.push_back(begin);
+		size_t pieceBegin = begin;
+		size_t pieceMisses = 0;
+		for (auto i = begin; i + 1 < end; ++i)
+		{
+			pieceMisses += misses(i);
+			if (static_cast<float>(pieceMisses) <= threshold * static_cast<float>(i + 1 - pieceBegin))
+			{
+				pieceBegin = i + 1;
+				pieceMisses = 0;
+				result.push_back(pieceBegin);
+				cache.flush();
+			}
+		}
+	}
+	clusters = std::move(result);
+}
+
+}// namespace fgl
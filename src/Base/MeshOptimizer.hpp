@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace fgl
+{
+
+// Vertex shader invocations of an index buffer under a FIFO post-transform cache.
+struct VertexCacheStats {
+	size_t transformed = 0;
+	size_t triangles = 0;
+	size_t vertices = 0;
+
+	// Average cache miss ratio: transformed vertices per triangle, 0.5 at best and 3 at worst.
+	[[nodiscard]] float acmr() const noexcept;
+	// Average transform to vertex ratio: transformed vertices per used vertex, 1 at best.
+	[[nodiscard]] float atvr() const noexcept;
+
+	VertexCacheStats & operator+=(const VertexCacheStats & other) noexcept;
+};
+
+// Index and vertex reordering for triangle lists, done once after loading:
+// - reorderTriangles() runs Tipsify (Sander et al. 2007) for post-transform cache locality, then
+//   sorts the resulting clusters so outward-facing ones come first and hide what lies behind them;
+// - reorderVertices() renumbers vertices in first-use order so vertex fetch streams through memory.
+class MeshOptimizer final
+{
+public:
+	// Close to the effective FIFO size of current GPUs, too large a value makes Tipsify thrash.
+	static constexpr size_t g_cache_size = 16;
+	// Clusters are split where their ACMR is within this factor of the whole cluster.
+	static constexpr float g_overdraw_threshold = 1.05f;
+
+	explicit MeshOptimizer(size_t cacheSize = g_cache_size) noexcept;
+
+	[[nodiscard]] size_t cacheSize() const noexcept { return cacheSize_; }
+
+	// Indices must be below vertexCount.
+	[[nodiscard]] VertexCacheStats analyze(std::span<const uint32_t> indices, size_t vertexCount) const;
+
+	// `positions` holds `stride` floats per vertex, xyz first.
+	void reorderTriangles(std::span<uint32_t> indices, std::span<const float> positions, size_t stride) const;
+
+	// Rewrites indices and returns remap[old] = new, ~0u for vertices no triangle uses.
+	[[nodiscard]] static std::vector<uint32_t> reorderVertices(std::span<uint32_t> indices, size_t vertexCount);
+	// Moves `stride` floats per vertex to their remapped place and drops unused ones. Returns the new vertex count.
+	static size_t remapVertices(std::vector<float> & vertices, size_t stride, std::span<const uint32_t> remap);
+
+private:
+	// Tipsify order of the triangles in `indices`, with the first triangle of every cluster it had to restart at.
+	void tipsify(std::span<const uint32_t> indices, size_t vertexCount, std::vector<uint32_t> & order,
+				 std::vector<size_t> & clusters) const;
+	void splitClusters(std::span<const uint32_t> indices, std::span<const uint32_t> order, size_t vertexCount,
+					   std::vector<size_t> & clusters) const;
+
+private:
+	size_t cacheSize_;
+};
+
+}// namespace fgl
@@ -0,0 +1,519 @@
+#include "MorphBlender.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FGL_MORPH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(FGL_MORPH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define FGL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define FGL_TARGET_AVX2
+#endif
+
+namespace fgl
+{
+
+namespace
+{
+
+// Elements per block. The output block stays in L2 while every target is streamed into it.
+constexpr size_t g_block_elements = 8192;
+
+struct Decode {
+	float scale = 1.0f;
+	// Signed normalized values below -1 are clamped as the glTF spec requires.
+	bool clamp = false;
+};
+
+using BlendFunction = void (*)(float * out, const std::byte * in, size_t n, const Decode & decode, float weight);
+using KernelRow = std::array<BlendFunction, 5>;
+
+struct KernelTable {
+	KernelRow assign;
+	KernelRow accumulate;
+};
+
+Decode decodeOf(const AttributeStream & stream)
+{
+	if (!stream.normalized)
+	{
+		return {};
+	}
+
+	switch (stream.type)
+	{
+		case ComponentType::Byte:
+			return {1.0f / 127.0f, true};
+		case ComponentType::UnsignedByte:
+			return {1.0f / 255.0f, false};
+		case ComponentType::Short:
+			return {1.0f / 32767.0f, true};
+		case ComponentType::UnsignedShort:
+			return {1.0f / 65535.0f, false};
+		case ComponentType::Float:
+			break;
+	}
+	return {};
+}
+
+template <typename T>
+float load(const std::byte * data)
+{
+	T value;
+	std::memcpy(&value, data, sizeof(T));
+	return static_cast<float>(value);
+}
+
+template <typename T>
+float decode(const std::byte * data, const Decode & decoder)
+{
+	if constexpr (std::is_same_v<T, float>)
+	{
+		return load<float>(data);
+	}
+	else
+	{
+		const auto value = load<T>(data) * decoder.scale;
+		return decoder.clamp ? std::max(value, -1.0f) : value;
+	}
+}
+
+template <typename T, bool Assign>
+void blendScalar(float * out, const std::byte * in, const size_t n, const Decode & decoder, const float weight)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto value = decode<T>(in + i * sizeof(T), decoder);
+		if constexpr (Assign)
+		{
+			out[i] = value;
+		}
+		else
+		{
+			out[i] += value * weight;
+		}
+	}
+}
+
+template <bool Assign>
+constexpr KernelRow scalarRow()
+{
+	return {&blendScalar<float, Assign>, &blendScalar<int8_t, Assign>, &blendScalar<uint8_t, Assign>,
+			&blendScalar<int16_t, Assign>, &blendScalar<uint16_t, Assign>};
+}
+
+#ifdef FGL_MORPH_X86
+
+template <typename T>
+__m128 loadSse2(const std::byte * data)
+{
+	const auto zero = _mm_setzero_si128();
+	if constexpr (std::is_same_v<T, float>)
+	{
+		return _mm_loadu_ps(reinterpret_cast<const float *>(data));
+	}
+	else if constexpr (sizeof(T) == 2)
+	{
+		const auto x = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(data));
+		const auto wide = std::is_signed_v<T> ? _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16) : _mm_unpacklo_epi16(x, zero);
+		return _mm_cvtepi32_ps(wide);
+	}
+	else
+	{
+		int packed;
+		std::memcpy(&packed, data, sizeof(packed));
+		const auto x = _mm_cvtsi32_si128(packed);
+		const auto wide = std::is_signed_v<T>
+			? _mm_srai_epi32(_mm_unpacklo_epi16(_mm_unpacklo_epi8(x, x), _mm_unpacklo_epi8(x, x)), 24)
+			: _mm_unpacklo_epi16(_mm_unpacklo_epi8(x, zero), zero);
+		return _mm_cvtepi32_ps(wide);
+	}
+}
+
+template <typename T, bool Assign>
+void blendSse2(float * out, const std::byte * in, const size_t n, const Decode & decoder, const float weight)
+{
+	const auto scale = _mm_set1_ps(decoder.scale);
+	const auto lower = _mm_set1_ps(-1.0f);
+	const auto w = _mm_set1_ps(weight);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		auto value = loadSse2<T>(in + i * sizeof(T));
+		if constexpr (!std::is_same_v<T, float>)
+		{
+			value = _mm_mul_ps(value, scale);
+			if (decoder.clamp)
+			{
+				value = _mm_max_ps(value, lower);
+			}
+		}
+
+		if constexpr (Assign)
+		{
+			_mm_storeu_ps(out + i, value);
+		}
+		else
+		{
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(value, w)));
+		}
+	}
+	blendScalar<T, Assign>(out + i, in + i * sizeof(T), n - i, decoder, weight);
+}
+
+template <bool Assign>
+constexpr KernelRow sse2Row()
+{
+	return {&blendSse2<float, Assign>, &blendSse2<int8_t, Assign>, &blendSse2<uint8_t, Assign>,
+			&blendSse2<int16_t, Assign>, &blendSse2<uint16_t, Assign>};
+}
+
+template <typename T>
+FGL_TARGET_AVX2 __m256 loadAvx2(const std::byte * data)
+{
+	if constexpr (std::is_same_v<T, float>)
+	{
+		return _mm256_loadu_ps(reinterpret_cast<const float *>(data));
+	}
+	else if constexpr (std::is_same_v<T, int16_t>)
+	{
+		return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data))));
+	}
+	else if constexpr (std::is_same_v<T, uint16_t>)
+	{
+		return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data))));
+	}
+	else if constexpr (std::is_same_v<T, int8_t>)
+	{
+		return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(data))));
+	}
+	else
+	{
+		return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(data))));
+	}
+}
+
+template <typename T, bool Assign>
+FGL_TARGET_AVX2 void blendAvx2(float * out, const std::byte * in, const size_t n, const Decode & decoder, const float weight)
+{
+	const auto scale = _mm256_set1_ps(decoder.scale);
+	const auto lower = _mm256_set1_ps(-1.0f);
+	const auto w = _mm256_set1_ps(weight);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		auto value = loadAvx2<T>(in + i * sizeof(T));
+		if constexpr (!std::is_same_v<T, float>)
+		{
+			value = _mm256_mul_ps(value, scale);
+			if (decoder.clamp)
+			{
+				value = _mm256_max_ps(value, lower);
+			}
+		}
+
+		if constexpr (Assign)
+		{
+			_mm256_storeu_ps(out + i, value);
+		}
+		else
+		{
+			_mm256_storeu_ps(out + i, _mm256_fmadd_ps(value, w, _mm256_loadu_ps(out + i)));
+		}
+	}
+	blendScalar<T, Assign>(out + i, in + i * sizeof(T), n - i, decoder, weight);
+}
+
+template <bool Assign>
+constexpr KernelRow avx2Row()
+{
+	return {&blendAvx2<float, Assign>, &blendAvx2<int8_t, Assign>, &blendAvx2<uint8_t, Assign>,
+			&blendAvx2<int16_t, Assign>, &blendAvx2<uint16_t, Assign>};
+}
+
+#endif
+
+bool cpuHasAvx2() noexcept
+{
+#if defined(FGL_MORPH_X86) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(FGL_MORPH_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	const auto fma = (info[2] & (1 << 12)) != 0;
+	const auto osxsave = (info[2] & (1 << 27)) != 0;
+	__cpuidex(info, 7, 0);
+	const auto avx2 = (info[1] & (1 << 5)) != 0;
+	return fma && osxsave && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+	return false;
+#endif
+}
+
+const KernelTable & tableOf(const MorphBlender::Kernel kernel) noexcept
+{
+	static constexpr KernelTable scalar{scalarRow<true>(), scalarRow<false>()};
+#ifdef FGL_MORPH_X86
+	static constexpr KernelTable sse2{sse2Row<true>(), sse2Row<false>()};
+	static constexpr KernelTable avx2{avx2Row<true>(), avx2Row<false>()};
+
+	switch (kernel)
+	{
+		case MorphBlender::Kernel::Avx2:
+			return avx2;
+		case MorphBlender::Kernel::Sse2:
+			return sse2;
+		case MorphBlender::Kernel::Scalar:
+			break;
+	}
+#else
+	(void)kernel;
+#endif
+	return scalar;
+}
+
+// Blends elements [first, first + n) of a stream into a block of `components`-wide output.
+void apply(const KernelRow & row, const bool assign, const AttributeStream & stream, const size_t first,
+		   const size_t n, const uint32_t components, float * out, const float weight)
+{
+	const auto decoder = decodeOf(stream);
+	if (stream.packed() && stream.components == components)
+	{
+		row[static_cast<size_t>(stream.type)](out, stream.data + first * stream.stride, n * components, decoder, weight);
+		return;
+	}
+
+	// Interleaved or narrower streams go element by element.
+	const auto size = stream.componentSize();
+	const auto width = std::min(stream.components, components);
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto * element = stream.data + (first + i) * stream.stride;
+		auto * target = out + i * components;
+		for (uint32_t k = 0; k < width; ++k)
+		{
+			float value = 0.0f;
+			switch (stream.type)
+			{
+				case ComponentType::Float:
+					value = decode<float>(element + k * size, decoder);
+					break;
+				case ComponentType::Byte:
+					value = decode<int8_t>(element + k * size, decoder);
+					break;
+				case ComponentType::UnsignedByte:
+					value = decode<uint8_t>(element + k * size, decoder);
+					break;
+				case ComponentType::Short:
+					value = decode<int16_t>(element + k * size, decoder);
+					break;
+				case ComponentType::UnsignedShort:
+					value = decode<uint16_t>(element + k * size, decoder);
+					break;
+			}
+			target[k] = assign ? value : target[k] + value * weight;
+		}
+	}
+}
+
+}// namespace
+
+size_t AttributeStream::componentSize() const noexcept
+{
+	switch (type)
+	{
+		case ComponentType::Byte:
+		case ComponentType::UnsignedByte:
+			return 1;
+		case ComponentType::Short:
+		case ComponentType::UnsignedShort:
+			return 2;
+		case ComponentType::Float:
+			break;
+	}
+	return 4;
+}
+
+auto MorphBlender::bestKernel() noexcept -> Kernel
+{
+	if (supported(Kernel::Avx2))
+	{
+		return Kernel::Avx2;
+	}
+	return supported(Kernel::Sse2) ? Kernel::Sse2 : Kernel::Scalar;
+}
+
+bool MorphBlender::supported(const Kernel kernel) noexcept
+{
+	switch (kernel)
+	{
+		case Kernel::Avx2:
+		{
+			static const auto avx2 = cpuHasAvx2();
+			return avx2;
+		}
+		case Kernel::Sse2:
+#ifdef FGL_MORPH_X86
+			return true;
+#else
+			return false;
+#endif
+		case Kernel::Scalar:
+			break;
+	}
+	return true;
+}
+
+const char * MorphBlender::name(const Kernel kernel) noexcept
+{
+	switch (kernel)
+	{
+		case Kernel::Avx2:
+			return "avx2";
+		case Kernel::Sse2:
+			return "sse2";
+		case Kernel::Scalar:
+			break;
+	}
+	return "scalar";
+}
+
+MorphBlender::MorphBlender(const Kernel kernel) noexcept
+	: kernel_{supported(kernel) ? kernel : Kernel::Scalar}
+{
+}
+
+void MorphBlender::blend(const AttributeStream & base, const std::span<const AttributeStream> targets,
+						 const std::span<const float> weights, const std::span<float> out, JobSystem * const jobs) const
+{
+	const auto components = base.components;
+	if (components == 0 || base.data == nullptr)
+	{
+		return;
+	}
+
+	const auto & table = tableOf(kernel_);
+	const auto count = std::min(base.count, out.size() / components);
+	const auto active = std::min(targets.size(), weights.size());
+
+	// Blocks only write their own part of `out`.
+	const auto blendBlocks = [&](const size_t firstBlock, const size_t lastBlock) {
+		for (auto first = firstBlock * g_block_elements; first < std::min(lastBlock * g_block_elements, count);
+			 first += g_block_elements)
+		{
+			const auto n = std::min(g_block_elements, count - first);
+			auto * block = out.data() + first * components;
+
+			apply(table.assign, true, base, first, n, components, block, 1.0f);
+			for (size_t i = 0; i < active; ++i)
+			{
+				if (weights[i] == 0.0f || targets[i].data == nullptr || targets[i].count < count)
+				{
+					continue;
+				}
+				apply(table.accumulate, false, targets[i], first, n, components, block, weights[i]);
+			}
+		}
+	};
+
+	const auto blocks = (count + g_block_elements - 1) / g_block_elements;
+	if (jobs)
+	{
+		jobs->parallelFor(blocks, 1, blendBlocks);
+	}
+	else
+	{
+		blendBlocks(0, blocks);
+	}
+}
+
+void MorphBlender::scatter(const std::span<const SparseTarget> targets, const std::span<const float> weights,
+						   const uint32_t components, const std::span<float> out) const
+{
+	if (components == 0)
+	{
+		return;
+	}
+
+	// Indices are sparse enough that gathers would not pay off, so every kernel shares this loop.
+	const auto count = out.size() / components;
+	const auto active = std::min(targets.size(), weights.size());
+	for (size_t i = 0; i < active; ++i)
+	{
+		const auto & target = targets[i];
+		const auto weight = weights[i];
+		if (weight == 0.0f || target.empty() || target.deltas.size() < target.indices.size() * target.components)
+		{
+			continue;
+		}
+
+		const auto width = std::min(target.components, components);
+		for (size_t j = 0; j < target.indices.size(); ++j)
+		{
+			const auto index = target.indices[j];
+			if (index >= count)
+			{
+				continue;
+			}
+
+			const auto * delta = target.deltas.data() + j * target.components;
+			auto * element = out.data() + index * components;
+			for (uint32_t k = 0; k < width; ++k)
+			{
+				element[k] += delta[k] * weight;
+			}
+		}
+	}
+}
+
+std::optional<SparseTarget> MorphBlender::compact(const AttributeStream & target, const size_t maxElements) const
+{
+	const auto components = target.components;
+	if (components == 0 || target.data == nullptr)
+	{
+		return std::nullopt;
+	}
+
+	SparseTarget sparse;
+	sparse.components = components;
+
+	// Decode block by block so a dense target never needs a full float copy.
+	const auto & table = tableOf(kernel_);
+	std::vector<float> block(std::min(target.count, g_block_elements) * components);
+	for (size_t first = 0; first < target.count; first += g_block_elements)
+	{
+		const auto n = std::min(g_block_elements, target.count - first);
+		apply(table.assign, true, target, first, n, components, block.data(), 1.0f);
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			const auto * element = block.data() + i * components;
+			if (std::all_of(element, element + components, [](const float value) { return value == 0.0f; }))
+			{
+				continue;
+			}
+
+			if (sparse.indices.size() == maxElements)
+			{
+				return std::nullopt;
+			}
+			sparse.indices.push_back(static_cast<uint32_t>(first + i));
+			sparse.deltas.insert(sparse.deltas.end(), element, element + components);
+		}
+	}
+	return sparse;
+}
+
+}// namespace fgl
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "JobSystem.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace fgl
+{
+
+enum class ComponentType
+{
+	Float,
+	Byte,
+	UnsignedByte,
+	Short,
+	UnsignedShort,
+};
+
+// View of a vertex attribute: `count` elements of `components` values each, `stride` bytes apart.
+struct AttributeStream {
+	const std::byte * data = nullptr;
+	size_t count = 0;
+	size_t stride = 0;
+	uint32_t components = 3;
+	ComponentType type = ComponentType::Float;
+	bool normalized = false;
+
+	[[nodiscard]] size_t componentSize() const noexcept;
+	[[nodiscard]] bool packed() const noexcept { return stride == components * componentSize(); }
+};
+
+// Morph target that only keeps the elements it moves. `deltas` holds `components` tightly packed
+// floats per entry of `indices`.
+struct SparseTarget {
+	std::vector<uint32_t> indices;
+	std::vector<float> deltas;
+	uint32_t components = 3;
+
+	[[nodiscard]] bool empty() const noexcept { return indices.empty(); }
+};
+
+class MorphBlender final
+{
+public:
+	enum class Kernel
+	{
+		Scalar,
+		Sse2,
+		Avx2,
+	};
+
+	[[nodiscard]] static Kernel bestKernel() noexcept;
+	[[nodiscard]] static bool supported(Kernel kernel) noexcept;
+	[[nodiscard]] static const char * name(Kernel kernel) noexcept;
+
+	explicit MorphBlender(Kernel kernel = bestKernel()) noexcept;
+
+	[[nodiscard]] Kernel kernel() const noexcept { return kernel_; }
+
+	// out = base + sum(weights[i] * targets[i]), written as tightly packed floats with base.components
+	// values per element. Targets with zero weight are skipped, targets may have fewer components
+	// than the base (e.g. vec3 tangent deltas for a vec4 tangent). Blocks of elements are blended as
+	// jobs when `jobs` is given.
+	void blend(const AttributeStream & base, std::span<const AttributeStream> targets,
+			   std::span<const float> weights, std::span<float> out, JobSystem * jobs = nullptr) const;
+
+	// out += sum(weights[i] * targets[i]) for an output of `components` floats per element, touching
+	// only the listed elements. Meant to run after blend() with the sparse targets left out of it.
+	void scatter(std::span<const SparseTarget> targets, std::span<const float> weights, uint32_t components,
+				 std::span<float> out) const;
+
+	// Keeps the non-zero elements of a dense target. Nothing if more than `maxElements` of them move.
+	[[nodiscard]] std::optional<SparseTarget> compact(const AttributeStream & target, size_t maxElements) const;
+
+private:
+	Kernel kernel_;
+};
+
+}// namespace fgl
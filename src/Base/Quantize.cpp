@@ -0,0 +1,87 @@
+#include "Quantize.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace fgl
+{
+
+uint16_t toHalf(const float value) noexcept
+{
+	auto bits = std::bit_cast<uint32_t>(value);
+	const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+	bits &= 0x7fffffffu;
+
+	// Infinity and NaN, NaN stays quiet.
+	if (bits >= 0x7f800000u)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00u | (bits > 0x7f800000u ? 0x0200u : 0u));
+	}
+	// 65520 and above round to infinity.
+	if (bits >= 0x477ff000u)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00u);
+	}
+
+	uint32_t half = 0;
+	uint32_t rest = 0;
+	uint32_t halfway = 0;
+	if (bits < 0x38800000u)
+	{
+		// Below 2^-14 the result is subnormal, below 2^-25 it is zero.
+		if (bits < 0x33000000u)
+		{
+			return sign;
+		}
+		const auto shift = 126u - (bits >> 23);
+		const auto mantissa = (bits & 0x7fffffu) | 0x800000u;
+		half = mantissa >> shift;
+		rest = mantissa & ((1u << shift) - 1u);
+		halfway = 1u << (shift - 1u);
+	}
+	else
+	{
+		// Rebias the exponent from 127 to 15 and drop 13 mantissa bits.
+		half = (bits - 0x38000000u) >> 13;
+		rest = bits & 0x1fffu;
+		halfway = 0x1000u;
+	}
+
+	// A carry out of the mantissa correctly bumps the exponent.
+	if (rest > halfway || (rest == halfway && (half & 1u)))
+	{
+		++half;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+float fromHalf(const uint16_t half) noexcept
+{
+	const auto sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+	const auto exponent = (half >> 10) & 0x1fu;
+	const auto mantissa = static_cast<uint32_t>(half & 0x3ffu);
+
+	if (exponent == 0)
+	{
+		const auto magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign ? -magnitude : magnitude;
+	}
+	if (exponent == 0x1f)
+	{
+		return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+	}
+	return std::bit_cast<float>(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+uint16_t toUnorm16(const float value) noexcept
+{
+	return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+uint8_t toUnorm8(const float value) noexcept
+{
+	return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+}// namespace fgl
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace fgl
+{
+
+// Scalar conversions for compact vertex formats, used once when vertex data is baked.
+
+// IEEE 754 binary16 with round to nearest even, overflow goes to infinity.
+[[nodiscard]] uint16_t toHalf(float value) noexcept;
+[[nodiscard]] float fromHalf(uint16_t half) noexcept;
+
+// Values in [0, 1], clamped, as GL normalized unsigned integers.
+[[nodiscard]] uint16_t toUnorm16(float value) noexcept;
+[[nodiscard]] uint8_t toUnorm8(float value) noexcept;
+
+}// namespace fgl
@@ -0,0 +1,57 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace fgl
+{
+
+uint64_t RenderQueue::key(const uint32_t program, const uint32_t material, const uint32_t vertexArray, const float depth) noexcept
+{
+	const auto field = [](const uint64_t value, const uint32_t bits) {
+		return value & ((uint64_t{1} << bits) - 1);
+	};
+
+	// Bits of a non-negative float order like the float, the top ones are a coarse depth.
+	const auto depthBits = std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> (32 - g_depth_bits);
+
+	auto key = field(program, g_program_bits);
+	key = (key << g_material_bits) | field(material, g_material_bits);
+	key = (key << g_vertex_array_bits) | field(vertexArray, g_vertex_array_bits);
+	key = (key << g_depth_bits) | depthBits;
+	return key;
+}
+
+void RenderQueue::sort()
+{
+	// LSD radix sort, byte by byte; bytes equal in all keys are skipped, which is most of them.
+	scratch_.resize(items_.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		std::array<size_t, 256> offsets{};
+		for (const auto & item: items_)
+		{
+			++offsets[(item.key >> shift) & 0xff];
+		}
+		if (std::any_of(offsets.begin(), offsets.end(), [&](const size_t count) { return count == items_.size(); }))
+		{
+			continue;
+		}
+
+		size_t sum = 0;
+		for (auto & offset: offsets)
+		{
+			const auto count = offset;
+			offset = sum;
+			sum += count;
+		}
+		for (const auto & item: items_)
+		{
+			scratch_[offsets[(item.key >> shift) & 0xff]++] = item;
+		}
+		items_.swap(scratch_);
+	}
+}
+
+}// namespace fgl
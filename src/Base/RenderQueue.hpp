@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace fgl
+{
+
+// Draw commands ordered by a 64-bit key that puts the most expensive state first, so a submit loop
+// only changes state where consecutive keys differ. Keys are radix sorted, the order is stable.
+class RenderQueue final
+{
+public:
+	struct Item {
+		uint64_t key = 0;
+		// Index into the caller's commands.
+		uint32_t command = 0;
+	};
+
+	// From the top: program, material, vertex array, then view depth so equal state draws front to back.
+	// Fields wider than their bits are masked.
+	static constexpr uint32_t g_program_bits = 8;
+	static constexpr uint32_t g_material_bits = 20;
+	static constexpr uint32_t g_vertex_array_bits = 20;
+	static constexpr uint32_t g_depth_bits = 16;
+
+	// Negative depths count as 0.
+	[[nodiscard]] static uint64_t key(uint32_t program, uint32_t material, uint32_t vertexArray, float depth) noexcept;
+
+	void clear() noexcept { items_.clear(); }
+	void push(uint64_t key, uint32_t command) { items_.push_back({key, command}); }
+	void sort();
+
+	[[nodiscard]] std::span<const Item> items() const noexcept { return items_; }
+	[[nodiscard]] size_t size() const noexcept { return items_.size(); }
+
+private:
+	std::vector<Item> items_;
+	std::vector<Item> scratch_;
+};
+
+// State changes of one submission.
+struct SubmitStats {
+	size_t draws = 0;
+	size_t binds = 0;
+	// Binds skipped because the state was already bound.
+	size_t bindsAvoided = 0;
+	// Releases of textures and VAOs a draw-by-draw loop would have issued after each draw on top.
+	size_t releasesAvoided = 0;
+};
+
+}// namespace fgl
@@ -0,0 +1,260 @@
+#include "RenderThread.hpp"
+
+#include "GLWidget.hpp"
+#include "Trace.hpp"
+
+#include <QDebug>
+#include <QGuiApplication>
+#include <QScreen>
+
+#include <thread>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr double g_default_refresh_rate = 60.0;
+
+}// namespace
+
+RenderThread::RenderThread(GLWidget & widget, std::function<void()> frameReady)
+	: widget_{widget}
+	, frameReady_{std::move(frameReady)}
+{
+	auto * shareContext = widget.context();
+
+	context_ = std::make_unique<QOpenGLContext>();
+	context_->setFormat(shareContext->format());
+	context_->setShareContext(shareContext);
+	if (!context_->create())
+	{
+		qWarning() << "Failed to create the render thread context";
+	}
+	context_->moveToThread(this);
+
+	surface_ = std::make_unique<QOffscreenSurface>();
+	surface_->setFormat(context_->format());
+	surface_->create();
+
+	// Nothing throttles offscreen rendering, so frames are paced to the display.
+	const auto * screen = QGuiApplication::primaryScreen();
+	const auto refreshRate = screen && screen->refreshRate() > 0.0 ? screen->refreshRate() : g_default_refresh_rate;
+	frameInterval_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / refreshRate));
+}
+
+RenderThread::~RenderThread()
+{
+	stop();
+}
+
+void RenderThread::resize(const size_t width, const size_t height)
+{
+	if (!resizes_.push({width, height}))
+	{
+		qWarning() << "Render thread is behind, dropped a resize";
+	}
+	requestFrame();
+}
+
+void RenderThread::requestFrame() noexcept
+{
+	frameRequested_.store(true, std::memory_order_release);
+	wakeups_.fetch_add(1, std::memory_order_release);
+	wakeups_.notify_one();
+}
+
+void RenderThread::stop()
+{
+	requestInterruption();
+	wakeups_.fetch_add(1, std::memory_order_release);
+	wakeups_.notify_one();
+	wait();
+
+	if (readFramebuffer_ != 0 && QOpenGLContext::currentContext())
+	{
+		QOpenGLContext::currentContext()->extraFunctions()->glDeleteFramebuffers(1, &readFramebuffer_);
+		readFramebuffer_ = 0;
+	}
+}
+
+bool RenderThread::present(const GLuint framebuffer, const size_t width, const size_t height)
+{
+	FGL_TRACE_SCOPE("RenderThread::present");
+
+	auto * gl = QOpenGLContext::currentContext()->extraFunctions();
+
+	// Take the newest frame, the one shown so far goes back with the fence of its last blit.
+	if (middle_.load(std::memory_order_acquire) & g_fresh)
+	{
+		front_ = middle_.exchange(front_, std::memory_order_acq_rel) & ~g_fresh;
+	}
+
+	auto & target = targets_[front_];
+	if (target.texture == 0)
+	{
+		return false;
+	}
+	if (target.rendered)
+	{
+		gl->glWaitSync(target.rendered, 0, GL_TIMEOUT_IGNORED);
+		gl->glDeleteSync(target.rendered);
+		target.rendered = nullptr;
+	}
+
+	if (readFramebuffer_ == 0)
+	{
+		gl->glGenFramebuffers(1, &readFramebuffer_);
+	}
+	gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer_);
+	gl->glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+	gl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	gl->glBlitFramebuffer(0, 0, static_cast<GLint>(target.size.width), static_cast<GLint>(target.size.height), 0, 0,
+						  static_cast<GLint>(width), static_cast<GLint>(height), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	gl->glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	gl->glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	if (target.presented)
+	{
+		gl->glDeleteSync(target.presented);
+	}
+	target.presented = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl->glFlush();
+	return true;
+}
+
+void RenderThread::run()
+{
+	Trace::setThreadName("render");
+
+	if (!context_->makeCurrent(surface_.get()))
+	{
+		qWarning() << "Failed to make the render thread context current";
+		return;
+	}
+	initializeOpenGLFunctions();
+	widget_.onInit();
+
+	nextFrame_ = std::chrono::steady_clock::now();
+	while (!isInterruptionRequested())
+	{
+		// Read before looking for work, so a request made meanwhile is never slept through.
+		const auto wakeups = wakeups_.load(std::memory_order_acquire);
+		const auto resized = applyResize();
+		if (size_.width == 0 || (!frameRequested_.exchange(false, std::memory_order_acq_rel) && !resized))
+		{
+			wakeups_.wait(wakeups, std::memory_order_acquire);
+			continue;
+		}
+
+		renderFrame();
+		frameReady_();
+
+		nextFrame_ += frameInterval_;
+		const auto now = std::chrono::steady_clock::now();
+		if (nextFrame_ < now)
+		{
+			nextFrame_ = now;
+		}
+		else
+		{
+			std::this_thread::sleep_until(nextFrame_);
+		}
+	}
+
+	widget_.onDestroy();
+	destroyTargets();
+	context_->doneCurrent();
+	// Back to the GUI thread, which deletes it.
+	context_->moveToThread(QGuiApplication::instance()->thread());
+}
+
+bool RenderThread::applyResize()
+{
+	const auto previous = size_;
+	while (const auto size = resizes_.pop())
+	{
+		size_ = *size;
+	}
+	const auto resized = size_.width != previous.width || size_.height != previous.height;
+	if (!resized || size_.width == 0 || size_.height == 0)
+	{
+		return false;
+	}
+
+	QOpenGLFramebufferObjectFormat format;
+	format.setSamples(context_->format().samples() > 0 ? context_->format().samples() : 0);
+	format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	multisampled_ = std::make_unique<QOpenGLFramebufferObject>(static_cast<int>(size_.width),
+															   static_cast<int>(size_.height), format);
+	multisampled_->bind();
+	widget_.onResize(size_.width, size_.height);
+	return true;
+}
+
+void RenderThread::renderFrame()
+{
+	FGL_TRACE_SCOPE("RenderThread::renderFrame");
+
+	auto & target = targets_[back_];
+
+	// A frame that was never shown is simply overwritten.
+	if (target.rendered)
+	{
+		glDeleteSync(target.rendered);
+		target.rendered = nullptr;
+	}
+
+	const auto resized = target.size.width != size_.width || target.size.height != size_.height;
+	if (target.presented)
+	{
+		// The GUI thread's blit has to finish on the GPU before the texture is written, or deleted.
+		if (resized)
+		{
+			glClientWaitSync(target.presented, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+		else
+		{
+			glWaitSync(target.presented, 0, GL_TIMEOUT_IGNORED);
+		}
+		glDeleteSync(target.presented);
+		target.presented = nullptr;
+	}
+	if (resized)
+	{
+		target.framebuffer = std::make_unique<QOpenGLFramebufferObject>(static_cast<int>(size_.width),
+																		static_cast<int>(size_.height), GL_TEXTURE_2D);
+		target.texture = target.framebuffer->texture();
+		target.size = size_;
+	}
+
+	multisampled_->bind();
+	widget_.onRender();
+	QOpenGLFramebufferObject::blitFramebuffer(target.framebuffer.get(), multisampled_.get());
+
+	target.rendered = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	back_ = middle_.exchange(back_ | g_fresh, std::memory_order_acq_rel) & ~g_fresh;
+}
+
+void RenderThread::destroyTargets()
+{
+	for (auto & target: targets_)
+	{
+		for (auto * sync: {&target.rendered, &target.presented})
+		{
+			if (*sync)
+			{
+				glDeleteSync(*sync);
+				*sync = nullptr;
+			}
+		}
+		target.framebuffer.reset();
+		target.texture = 0;
+	}
+	multisampled_.reset();
+}
+
+}// namespace fgl
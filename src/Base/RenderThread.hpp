@@ -0,0 +1,110 @@
+#pragma once
+
+#include "SpscQueue.hpp"
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QThread>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace fgl
+{
+
+class GLWidget;
+
+// Runs a GLWidget's onInit(), onRender(), onResize() and onDestroy() on its own thread, with a context
+// sharing textures with the widget's and an offscreen surface. Frames are rendered into a multisampled
+// framebuffer and resolved into one of three textures: the render thread writes one, the GUI thread
+// shows another and the third holds the newest finished frame. Handing them over is one atomic
+// exchange, fences order the GPU work of both contexts, so neither thread ever waits for the other.
+class RenderThread final : public QThread
+	, protected QOpenGLExtraFunctions
+{
+public:
+	static constexpr size_t g_buffers = 3;
+
+	// Create on the GUI thread with the widget's context current. `frameReady` is called on the render
+	// thread after every frame.
+	RenderThread(GLWidget & widget, std::function<void()> frameReady);
+	~RenderThread() override;
+
+	RenderThread(const RenderThread &) = delete;
+	RenderThread(RenderThread &&) = delete;
+
+	RenderThread & operator=(const RenderThread &) = delete;
+	RenderThread & operator=(RenderThread &&) = delete;
+
+	// GUI thread, passed to the render thread through a queue.
+	void resize(size_t width, size_t height);
+	// Any thread, schedules another frame.
+	void requestFrame() noexcept;
+	// GUI thread, waits for onDestroy() to finish.
+	void stop();
+
+	// GUI thread with the widget's context current: blits the newest frame into `framebuffer`,
+	// false before the first one.
+	bool present(GLuint framebuffer, size_t width, size_t height);
+
+protected: // QThread
+	void run() override;
+
+private:
+	struct Size {
+		size_t width = 0;
+		size_t height = 0;
+	};
+
+	struct Target {
+		std::unique_ptr<QOpenGLFramebufferObject> framebuffer;
+		// Shared with the widget's context.
+		GLuint texture = 0;
+		Size size;
+		// Signalled once the frame is resolved, and once the GUI thread's blit of it is done.
+		GLsync rendered = nullptr;
+		GLsync presented = nullptr;
+	};
+
+	// Bit on the shared index while its target holds a frame the GUI thread has not taken yet.
+	static constexpr uint32_t g_fresh = 1u << 31;
+
+	// Render thread.
+	bool applyResize();
+	void renderFrame();
+	void destroyTargets();
+
+private:
+	GLWidget & widget_;
+	std::function<void()> frameReady_;
+	std::unique_ptr<QOpenGLContext> context_;
+	std::unique_ptr<QOffscreenSurface> surface_;
+
+	SpscQueue<Size, 16> resizes_;
+	std::atomic<bool> frameRequested_{true};
+	// Bumped on every request, the render thread sleeps on it while idle.
+	std::atomic<uint32_t> wakeups_{0};
+
+	std::array<Target, g_buffers> targets_;
+	uint32_t back_ = 0;
+	std::atomic<uint32_t> middle_{1};
+	uint32_t front_ = 2;
+
+	// Render thread only.
+	Size size_;
+	std::unique_ptr<QOpenGLFramebufferObject> multisampled_;
+	std::chrono::nanoseconds frameInterval_;
+	std::chrono::steady_clock::time_point nextFrame_;
+
+	// GUI thread only, reads the shown target.
+	GLuint readFramebuffer_ = 0;
+};
+
+}// namespace fgl
@@ -0,0 +1,227 @@
+#include "SceneGraph.hpp"
+
+#include <algorithm>
+
+namespace fgl
+{
+
+uint32_t SceneGraph::add(const uint32_t parent, const Transform & local)
+{
+	const auto node = append(parent, 0);
+	for (size_t i = 0; i < 3; ++i)
+	{
+		translations_[i][node] = local.translation[i];
+		scales_[i][node] = local.scale[i];
+	}
+	for (size_t i = 0; i < 4; ++i)
+	{
+		rotations_[i][node] = local.rotation[i];
+	}
+	updateLocal(node);
+	updateWorld(node);
+	return node;
+}
+
+uint32_t SceneGraph::add(const uint32_t parent, const std::span<const float, 16> local)
+{
+	const auto node = append(parent, g_fixed);
+	for (size_t row = 0; row < 3; ++row)
+	{
+		for (size_t column = 0; column < 4; ++column)
+		{
+			locals_[row * 4 + column][node] = local[column * 4 + row];
+		}
+	}
+	updateWorld(node);
+	return node;
+}
+
+void SceneGraph::clear()
+{
+	parents_.clear();
+	flags_.clear();
+	for (auto & elements: translations_)
+	{
+		elements.clear();
+	}
+	for (auto & elements: rotations_)
+	{
+		elements.clear();
+	}
+	for (auto & elements: scales_)
+	{
+		elements.clear();
+	}
+	for (size_t i = 0; i < 12; ++i)
+	{
+		locals_[i].clear();
+		worlds_[i].clear();
+	}
+	firstDirty_ = g_none;
+	changed_.clear();
+}
+
+void SceneGraph::setTranslation(const uint32_t node, const std::span<const float, 3> translation) noexcept
+{
+	for (size_t i = 0; i < 3; ++i)
+	{
+		translations_[i][node] = translation[i];
+	}
+	markDirty(node);
+}
+
+void SceneGraph::setRotation(const uint32_t node, const std::span<const float, 4> rotation) noexcept
+{
+	for (size_t i = 0; i < 4; ++i)
+	{
+		rotations_[i][node] = rotation[i];
+	}
+	markDirty(node);
+}
+
+void SceneGraph::setScale(const uint32_t node, const std::span<const float, 3> scale) noexcept
+{
+	for (size_t i = 0; i < 3; ++i)
+	{
+		scales_[i][node] = scale[i];
+	}
+	markDirty(node);
+}
+
+std::span<const uint32_t> SceneGraph::update()
+{
+	for (const auto node: changed_)
+	{
+		flags_[node] &= static_cast<uint8_t>(~g_world_changed);
+	}
+	changed_.clear();
+	if (firstDirty_ == g_none)
+	{
+		return changed_;
+	}
+
+	// Parents come first, so a moved parent is already marked when its children are reached.
+	const auto count = static_cast<uint32_t>(size());
+	for (auto node = firstDirty_; node < count; ++node)
+	{
+		const auto flags = flags_[node];
+		const auto parent = parents_[node];
+		const auto moved = parent != g_none && (flags_[parent] & g_world_changed);
+		if (!moved && !(flags & g_local_dirty))
+		{
+			continue;
+		}
+
+		if (flags & g_local_dirty)
+		{
+			updateLocal(node);
+		}
+		updateWorld(node);
+		flags_[node] = static_cast<uint8_t>((flags & g_fixed) | g_world_changed);
+		changed_.push_back(node);
+	}
+	firstDirty_ = g_none;
+	return changed_;
+}
+
+std::array<float, 16> SceneGraph::world(const uint32_t node) const noexcept
+{
+	std::array<float, 16> matrix{};
+	for (size_t row = 0; row < 3; ++row)
+	{
+		for (size_t column = 0; column < 4; ++column)
+		{
+			matrix[column * 4 + row] = worlds_[row * 4 + column][node];
+		}
+	}
+	matrix[15] = 1.0f;
+	return matrix;
+}
+
+uint32_t SceneGraph::append(const uint32_t parent, const uint8_t flags)
+{
+	const auto node = static_cast<uint32_t>(size());
+	parents_.push_back(parent < node ? parent : g_none);
+	flags_.push_back(flags);
+
+	constexpr std::array<float, 12> identity{1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+	for (size_t i = 0; i < 3; ++i)
+	{
+		translations_[i].push_back(0.0f);
+		scales_[i].push_back(1.0f);
+	}
+	for (size_t i = 0; i < 4; ++i)
+	{
+		rotations_[i].push_back(i == 3 ? 1.0f : 0.0f);
+	}
+	for (size_t i = 0; i < 12; ++i)
+	{
+		locals_[i].push_back(identity[i]);
+		worlds_[i].push_back(identity[i]);
+	}
+	return node;
+}
+
+void SceneGraph::markDirty(const uint32_t node) noexcept
+{
+	if (flags_[node] & g_fixed)
+	{
+		return;
+	}
+	flags_[node] |= g_local_dirty;
+	firstDirty_ = std::min(firstDirty_, node);
+}
+
+void SceneGraph::updateLocal(const uint32_t node) noexcept
+{
+	const auto x = rotations_[0][node];
+	const auto y = rotations_[1][node];
+	const auto z = rotations_[2][node];
+	const auto w = rotations_[3][node];
+
+	// Scaled by the squared norm, so unnormalized keys still give a rotation.
+	const auto norm = x * x + y * y + z * z + w * w;
+	const auto s = norm > 0.0f ? 2.0f / norm : 0.0f;
+	const std::array<float, 9> rotation{
+		1.0f - s * (y * y + z * z), s * (x * y - z * w),        s * (x * z + y * w),
+		s * (x * y + z * w),        1.0f - s * (x * x + z * z), s * (y * z - x * w),
+		s * (x * z - y * w),        s * (y * z + x * w),        1.0f - s * (x * x + y * y),
+	};
+
+	// Translation * rotation * scale.
+	for (size_t row = 0; row < 3; ++row)
+	{
+		for (size_t column = 0; column < 3; ++column)
+		{
+			locals_[row * 4 + column][node] = rotation[row * 3 + column] * scales_[column][node];
+		}
+		locals_[row * 4 + 3][node] = translations_[row][node];
+	}
+}
+
+void SceneGraph::updateWorld(const uint32_t node) noexcept
+{
+	const auto parent = parents_[node];
+	if (parent == g_none)
+	{
+		for (size_t i = 0; i < 12; ++i)
+		{
+			worlds_[i][node] = locals_[i][node];
+		}
+		return;
+	}
+
+	for (size_t row = 0; row < 3; ++row)
+	{
+		const auto p0 = worlds_[row * 4][parent];
+		const auto p1 = worlds_[row * 4 + 1][parent];
+		const auto p2 = worlds_[row * 4 + 2][parent];
+		for (size_t column = 0; column < 4; ++column)
+		{
+			worlds_[row * 4 + column][node] = p0 * locals_[column][node] + p1 * locals_[4 + column][node]
+				+ p2 * locals_[8 + column][node] + (column == 3 ? worlds_[row * 4 + 3][parent] : 0.0f);
+		}
+	}
+}
+
+}// namespace fgl
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace fgl
+{
+
+// Node hierarchy flattened into parent-first order, so one forward pass sees every parent before its
+// children. Local transforms and world matrices are stored structure-of-arrays as floats; world matrices
+// are affine, element (row, column) of a node lives in worlds_[row * 4 + column].
+// Setting a transform only marks the node. update() recomputes the marked nodes and everything below
+// them, starting at the first marked one, and returns at once when nothing changed.
+class SceneGraph final
+{
+public:
+	static constexpr uint32_t g_none = UINT32_MAX;
+
+	struct Transform {
+		std::array<float, 3> translation{0.0f, 0.0f, 0.0f};
+		// Quaternion x, y, z, w.
+		std::array<float, 4> rotation{0.0f, 0.0f, 0.0f, 1.0f};
+		std::array<float, 3> scale{1.0f, 1.0f, 1.0f};
+	};
+
+	// Parents have to be added before their children, anything else becomes a root. The world matrix
+	// is valid right away. Nodes given a column-major matrix keep it, setting their transform does nothing.
+	uint32_t add(uint32_t parent, const Transform & local);
+	uint32_t add(uint32_t parent, std::span<const float, 16> local);
+	void clear();
+
+	[[nodiscard]] size_t size() const noexcept { return parents_.size(); }
+	[[nodiscard]] uint32_t parent(uint32_t node) const noexcept { return parents_[node]; }
+
+	// Take effect on the next update().
+	void setTranslation(uint32_t node, std::span<const float, 3> translation) noexcept;
+	void setRotation(uint32_t node, std::span<const float, 4> rotation) noexcept;
+	void setScale(uint32_t node, std::span<const float, 3> scale) noexcept;
+
+	// Recomputes the world matrices of changed nodes and their descendants. Returns those nodes in
+	// ascending order, valid until the next update().
+	std::span<const uint32_t> update();
+	// Whether the last update() recomputed a node.
+	[[nodiscard]] bool changed(uint32_t node) const noexcept { return (flags_[node] & g_world_changed) != 0; }
+
+	// Column-major 4x4 world matrix.
+	[[nodiscard]] std::array<float, 16> world(uint32_t node) const noexcept;
+
+private:
+	static constexpr uint8_t g_local_dirty = 1u << 0;
+	static constexpr uint8_t g_fixed = 1u << 1;
+	static constexpr uint8_t g_world_changed = 1u << 2;
+
+	uint32_t append(uint32_t parent, uint8_t flags);
+	void markDirty(uint32_t node) noexcept;
+	void updateLocal(uint32_t node) noexcept;
+	void updateWorld(uint32_t node) noexcept;
+
+private:
+	std::vector<uint32_t> parents_;
+	std::vector<uint8_t> flags_;
+
+	std::array<std::vector<float>, 3> translations_;
+	std::array<std::vector<float>, 4> rotations_;
+	std::array<std::vector<float>, 3> scales_;
+	// Top three rows of the local and world matrices.
+	std::array<std::vector<float>, 12> locals_;
+	std::array<std::vector<float>, 12> worlds_;
+
+	uint32_t firstDirty_ = g_none;
+	std::vector<uint32_t> changed_;
+};
+
+}// namespace fgl
@@ -0,0 +1,313 @@
+#include "Skinning.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FGL_SKIN_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(FGL_SKIN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define FGL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define FGL_TARGET_AVX2
+#endif
+
+namespace fgl
+{
+
+namespace
+{
+
+// Skins are padded to this many joints, the widest kernel's.
+constexpr size_t g_joint_block = 8;
+
+using Binds = std::array<const float *, Skinning::g_matrix_size>;
+
+// Joints [first, count) of a skin. World element (row, column) is at [column * 4 + row].
+void paletteScalar(const float * worlds, const Binds & binds, const size_t first, const size_t count, float * out)
+{
+	for (auto joint = first; joint < count; ++joint)
+	{
+		const auto * world = worlds + joint * 16;
+		auto * matrix = out + joint * Skinning::g_matrix_size;
+		for (size_t row = 0; row < 3; ++row)
+		{
+			for (size_t column = 0; column < 4; ++column)
+			{
+				matrix[row * 4 + column] = world[row] * binds[column][joint] + world[4 + row] * binds[4 + column][joint]
+					+ world[8 + row] * binds[8 + column][joint] + (column == 3 ? world[12 + row] : 0.0f);
+			}
+		}
+	}
+}
+
+void skinScalar(const float * positions, const uint16_t * joints, const float * weights, const float * palette,
+				const size_t paletteJoints, const size_t first, const size_t count, float * out)
+{
+	for (auto vertex = first; vertex < count; ++vertex)
+	{
+		std::array<float, Skinning::g_matrix_size> blended{};
+		for (size_t i = 0; i < Skinning::g_influences; ++i)
+		{
+			const auto weight = weights[vertex * Skinning::g_influences + i];
+			const auto joint = joints[vertex * Skinning::g_influences + i];
+			if (weight == 0.0f || joint >= paletteJoints)
+			{
+				continue;
+			}
+			const auto * matrix = palette + size_t{joint} * Skinning::g_matrix_size;
+			for (size_t k = 0; k < Skinning::g_matrix_size; ++k)
+			{
+				blended[k] += weight * matrix[k];
+			}
+		}
+
+		const auto * position = positions + vertex * 3;
+		for (size_t row = 0; row < 3; ++row)
+		{
+			out[vertex * 3 + row] = blended[row * 4] * position[0] + blended[row * 4 + 1] * position[1]
+				+ blended[row * 4 + 2] * position[2] + blended[row * 4 + 3];
+		}
+	}
+}
+
+#ifdef FGL_SKIN_X86
+
+void paletteSse2(const float * worlds, const Binds & binds, const size_t count, float * out)
+{
+	size_t joint = 0;
+	for (; joint + 4 <= count; joint += 4)
+	{
+		// World element (row, column) of four joints per register.
+		__m128 world[4][4];
+		for (size_t column = 0; column < 4; ++column)
+		{
+			auto & rows = world[column];
+			for (size_t i = 0; i < 4; ++i)
+			{
+				rows[i] = _mm_loadu_ps(worlds + (joint + i) * 16 + column * 4);
+			}
+			_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+		}
+
+		for (size_t row = 0; row < 3; ++row)
+		{
+			__m128 result[4];
+			for (size_t column = 0; column < 4; ++column)
+			{
+				auto value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(world[0][row], _mm_loadu_ps(binds[column] + joint)),
+												   _mm_mul_ps(world[1][row], _mm_loadu_ps(binds[4 + column] + joint))),
+										_mm_mul_ps(world[2][row], _mm_loadu_ps(binds[8 + column] + joint)));
+				result[column] = column == 3 ? _mm_add_ps(value, world[3][row]) : value;
+			}
+			_MM_TRANSPOSE4_PS(result[0], result[1], result[2], result[3]);
+			for (size_t i = 0; i < 4; ++i)
+			{
+				_mm_storeu_ps(out + (joint + i) * Skinning::g_matrix_size + row * 4, result[i]);
+			}
+		}
+	}
+	paletteScalar(worlds, binds, joint, count, out);
+}
+
+// Transposes the 4x4 blocks in both 128-bit lanes.
+FGL_TARGET_AVX2 void transposeAvx2(__m256 * rows)
+{
+	const auto t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+	const auto t1 = _mm256_unpacklo_ps(rows[2], rows[3]);
+	const auto t2 = _mm256_unpackhi_ps(rows[0], rows[1]);
+	const auto t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+	rows[0] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+	rows[1] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+	rows[2] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	rows[3] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+FGL_TARGET_AVX2 void paletteAvx2(const float * worlds, const Binds & binds, const size_t count, float * out)
+{
+	size_t joint = 0;
+	for (; joint + 8 <= count; joint += 8)
+	{
+		// Joints 0 to 3 in the low lanes, 4 to 7 in the high ones.
+		__m256 world[4][4];
+		for (size_t column = 0; column < 4; ++column)
+		{
+			auto & rows = world[column];
+			for (size_t i = 0; i < 4; ++i)
+			{
+				const auto low = _mm_loadu_ps(worlds + (joint + i) * 16 + column * 4);
+				const auto high = _mm_loadu_ps(worlds + (joint + 4 + i) * 16 + column * 4);
+				rows[i] = _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+			}
+			transposeAvx2(rows);
+		}
+
+		for (size_t row = 0; row < 3; ++row)
+		{
+			__m256 result[4];
+			for (size_t column = 0; column < 4; ++column)
+			{
+				auto value = column == 3 ? world[3][row] : _mm256_setzero_ps();
+				value = _mm256_fmadd_ps(world[0][row], _mm256_loadu_ps(binds[column] + joint), value);
+				value = _mm256_fmadd_ps(world[1][row], _mm256_loadu_ps(binds[4 + column] + joint), value);
+				result[column] = _mm256_fmadd_ps(world[2][row], _mm256_loadu_ps(binds[8 + column] + joint), value);
+			}
+			transposeAvx2(result);
+			for (size_t i = 0; i < 4; ++i)
+			{
+				_mm_storeu_ps(out + (joint + i) * Skinning::g_matrix_size + row * 4, _mm256_castps256_ps128(result[i]));
+				_mm_storeu_ps(out + (joint + 4 + i) * Skinning::g_matrix_size + row * 4, _mm256_extractf128_ps(result[i], 1));
+			}
+		}
+	}
+	paletteScalar(worlds, binds, joint, count, out);
+}
+
+// Two vertices at once, one per 128-bit lane. Influences without a weight or outside the palette add zero.
+FGL_TARGET_AVX2 void skinAvx2(const float * positions, const uint16_t * joints, const float * weights, const float * palette,
+							  const size_t paletteJoints, const size_t count, float * out)
+{
+	static constexpr std::array<float, Skinning::g_matrix_size> zero{};
+	const auto influence = [&](const size_t vertex, const size_t i, float & weight) {
+		weight = weights[vertex * Skinning::g_influences + i];
+		const auto joint = joints[vertex * Skinning::g_influences + i];
+		if (weight == 0.0f || joint >= paletteJoints)
+		{
+			weight = 0.0f;
+			return zero.data();
+		}
+		return palette + size_t{joint} * Skinning::g_matrix_size;
+	};
+
+	// Each lane is stored with an extra float that the next vertex overwrites, so the last one is not wide.
+	size_t vertex = 0;
+	for (; vertex + 2 < count; vertex += 2)
+	{
+		__m256 rows[3] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+		for (size_t i = 0; i < Skinning::g_influences; ++i)
+		{
+			float low = 0.0f;
+			float high = 0.0f;
+			const auto * lowMatrix = influence(vertex, i, low);
+			const auto * highMatrix = influence(vertex + 1, i, high);
+			const auto w = _mm256_insertf128_ps(_mm256_set1_ps(low), _mm_set1_ps(high), 1);
+			for (size_t row = 0; row < 3; ++row)
+			{
+				const auto matrix = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lowMatrix + row * 4)),
+														 _mm_loadu_ps(highMatrix + row * 4), 1);
+				rows[row] = _mm256_fmadd_ps(w, matrix, rows[row]);
+			}
+		}
+
+		const auto * position = positions + vertex * 3;
+		const auto point = _mm256_setr_ps(position[0], position[1], position[2], 1.0f, position[3], position[4], position[5], 1.0f);
+		// Horizontal sums of the three row products, x, y, z and zero in each lane.
+		const auto xy = _mm256_hadd_ps(_mm256_mul_ps(rows[0], point), _mm256_mul_ps(rows[1], point));
+		const auto z = _mm256_hadd_ps(_mm256_mul_ps(rows[2], point), _mm256_setzero_ps());
+		const auto result = _mm256_hadd_ps(xy, z);
+		_mm_storeu_ps(out + vertex * 3, _mm256_castps256_ps128(result));
+		_mm_storeu_ps(out + vertex * 3 + 3, _mm256_extractf128_ps(result, 1));
+	}
+	skinScalar(positions, joints, weights, palette, paletteJoints, vertex, count, out);
+}
+
+#endif
+
+}// namespace
+
+Skinning::Skinning(const Kernel kernel) noexcept
+	: kernel_{MorphBlender::supported(kernel) ? kernel : Kernel::Scalar}
+{
+}
+
+size_t Skinning::add(const std::span<const float> inverseBinds)
+{
+	const auto joints = inverseBinds.size() / 16;
+	const auto first = inverseBinds_[0].size();
+	const auto padded = (joints + g_joint_block - 1) / g_joint_block * g_joint_block;
+	for (auto & elements: inverseBinds_)
+	{
+		elements.resize(first + padded, 0.0f);
+	}
+
+	for (size_t joint = 0; joint < joints; ++joint)
+	{
+		const auto * matrix = inverseBinds.data() + joint * 16;
+		for (size_t row = 0; row < 3; ++row)
+		{
+			for (size_t column = 0; column < 4; ++column)
+			{
+				inverseBinds_[row * 4 + column][first + joint] = matrix[column * 4 + row];
+			}
+		}
+	}
+
+	firstJoints_.push_back(first);
+	jointCounts_.push_back(joints);
+	return firstJoints_.size() - 1;
+}
+
+void Skinning::clear()
+{
+	for (auto & elements: inverseBinds_)
+	{
+		elements.clear();
+	}
+	firstJoints_.clear();
+	jointCounts_.clear();
+}
+
+void Skinning::palette(const size_t skin, const std::span<const float> worlds, const std::span<float> out) const
+{
+	const auto count = jointCounts_[skin];
+	if (worlds.size() < count * 16 || out.size() < count * g_matrix_size)
+	{
+		return;
+	}
+
+	Binds binds;
+	for (size_t i = 0; i < g_matrix_size; ++i)
+	{
+		binds[i] = inverseBinds_[i].data() + firstJoints_[skin];
+	}
+
+	switch (kernel_)
+	{
+#ifdef FGL_SKIN_X86
+		case Kernel::Avx2:
+			paletteAvx2(worlds.data(), binds, count, out.data());
+			return;
+		case Kernel::Sse2:
+			paletteSse2(worlds.data(), binds, count, out.data());
+			return;
+#endif
+		default:
+			break;
+	}
+	paletteScalar(worlds.data(), binds, 0, count, out.data());
+}
+
+void Skinning::skin(const std::span<const float> positions, const std::span<const uint16_t> joints,
+					const std::span<const float> weights, const std::span<const float> palette,
+					const std::span<float> out) const
+{
+	const auto count = std::min({positions.size() / 3, joints.size() / g_influences, weights.size() / g_influences,
+								 out.size() / 3});
+	const auto paletteJoints = palette.size() / g_matrix_size;
+
+	switch (kernel_)
+	{
+#ifdef FGL_SKIN_X86
+		case Kernel::Avx2:
+			skinAvx2(positions.data(), joints.data(), weights.data(), palette.data(), paletteJoints, count, out.data());
+			return;
+#endif
+		default:
+			break;
+	}
+	// SSE2 skinning measured slower than this loop in skin-bench, so only palettes use SSE2.
+	skinScalar(positions.data(), joints.data(), weights.data(), palette.data(), paletteJoints, 0, count, out.data());
+}
+
+}// namespace fgl
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "MorphBlender.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace fgl
+{
+
+// Linear blend skinning. Skin matrices are affine and kept as their top three rows, 12 floats row-major,
+// which is also how GPU skinning fetches them: three RGBA texels per joint.
+// Inverse bind matrices are stored structure-of-arrays, so the SIMD kernels compute 4 or 8 joints at once.
+class Skinning final
+{
+public:
+	using Kernel = MorphBlender::Kernel;
+
+	// Floats per skin matrix.
+	static constexpr size_t g_matrix_size = 12;
+	// Influences per vertex, as JOINTS_0 and WEIGHTS_0.
+	static constexpr size_t g_influences = 4;
+
+	explicit Skinning(Kernel kernel = MorphBlender::bestKernel()) noexcept;
+
+	[[nodiscard]] Kernel kernel() const noexcept { return kernel_; }
+
+	// Keeps the inverse bind matrices of a skin, 16 column-major floats per joint, and returns its index.
+	size_t add(std::span<const float> inverseBinds);
+	void clear();
+
+	[[nodiscard]] size_t size() const noexcept { return firstJoints_.size(); }
+	[[nodiscard]] size_t jointCount(size_t skin) const noexcept { return jointCounts_[skin]; }
+
+	// Skin matrices world(joint) * inverseBind(joint) of a skin. `worlds` holds a column-major affine
+	// matrix (16 floats) per joint, `out` receives g_matrix_size floats per joint.
+	void palette(size_t skin, std::span<const float> worlds, std::span<float> out) const;
+
+	// The CPU reference of what the vertex shader does: every position (3 floats) is transformed by the
+	// weighted sum of the skin matrices of its joints, g_influences joints and weights per vertex.
+	void skin(std::span<const float> positions, std::span<const uint16_t> joints, std::span<const float> weights,
+			  std::span<const float> palette, std::span<float> out) const;
+
+private:
+	Kernel kernel_;
+
+	// Top three rows of every inverse bind matrix, element (row, column) at [row * 4 + column]. Skins
+	// start at a multiple of 8 joints so full SIMD loads never mix two of them.
+	std::array<std::vector<float>, g_matrix_size> inverseBinds_;
+	std::vector<size_t> firstJoints_;
+	std::vector<size_t> jointCounts_;
+};
+
+}// namespace fgl
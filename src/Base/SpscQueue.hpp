@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+namespace fgl
+{
+
+// Bounded single-producer single-consumer ring. One thread pushes and one thread pops, neither ever
+// locks or waits; push() fails when the ring is full.
+template<typename T, size_t Capacity>
+class SpscQueue final
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+	static_assert(std::is_trivially_copyable_v<T>, "slots are overwritten without destruction");
+
+public:
+	SpscQueue() = default;
+
+	SpscQueue(const SpscQueue &) = delete;
+	SpscQueue(SpscQueue &&) = delete;
+
+	SpscQueue & operator=(const SpscQueue &) = delete;
+	SpscQueue & operator=(SpscQueue &&) = delete;
+
+	// Producer side.
+	bool push(const T & value) noexcept
+	{
+		const auto tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) == Capacity)
+		{
+			return false;
+		}
+		slots_[tail & (Capacity - 1)] = value;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side.
+	std::optional<T> pop() noexcept
+	{
+		const auto head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire))
+		{
+			return std::nullopt;
+		}
+		const auto value = slots_[head & (Capacity - 1)];
+		head_.store(head + 1, std::memory_order_release);
+		return value;
+	}
+
+	// Either side, exact only while the other side is idle.
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+	}
+
+private:
+	// Indices only grow and are wrapped on access, on separate cache lines so both sides do not contend.
+	alignas(64) std::atomic<size_t> head_{0};
+	alignas(64) std::atomic<size_t> tail_{0};
+	alignas(64) std::array<T, Capacity> slots_{};
+};
+
+}// namespace fgl
@@ -0,0 +1,182 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr size_t g_thread_capacity = size_t{1} << 16;
+
+struct Event {
+	const char * name;
+	int64_t begin;
+	int64_t end;
+};
+
+// Written by its thread only. Buffers outlive their threads so a flush still sees them.
+struct ThreadBuffer {
+	// Allocated with the first event, threads that never record stay cheap.
+	std::unique_ptr<Event[]> events;
+	std::atomic<size_t> count{0};
+	std::atomic<uint64_t> dropped{0};
+	std::atomic<const char *> name{nullptr};
+	size_t id = 0;
+};
+
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	std::string path;
+};
+
+Registry & registry()
+{
+	static Registry instance;
+	return instance;
+}
+
+ThreadBuffer & localBuffer()
+{
+	// Registration is the only locked step, once per thread.
+	thread_local ThreadBuffer * buffer = [] {
+		auto & instance = registry();
+		const std::lock_guard lock{instance.mutex};
+		instance.buffers.push_back(std::make_unique<ThreadBuffer>());
+		instance.buffers.back()->id = instance.buffers.size();
+		return instance.buffers.back().get();
+	}();
+	return *buffer;
+}
+
+void writeString(std::FILE * file, const char * text)
+{
+	std::fputc('"', file);
+	for (; *text; ++text)
+	{
+		if (*text == '"' || *text == '\\')
+		{
+			std::fputc('\\', file);
+		}
+		if (static_cast<unsigned char>(*text) >= 0x20)
+		{
+			std::fputc(*text, file);
+		}
+	}
+	std::fputc('"', file);
+}
+
+}// namespace
+
+void Trace::start(std::string path)
+{
+	{
+		auto & instance = registry();
+		const std::lock_guard lock{instance.mutex};
+		instance.path = std::move(path);
+	}
+	// Fix the time origin before the first event.
+	(void)now();
+	enabled_.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop() noexcept
+{
+	enabled_.store(false, std::memory_order_relaxed);
+}
+
+bool Trace::flush()
+{
+	std::string path;
+	{
+		auto & instance = registry();
+		const std::lock_guard lock{instance.mutex};
+		path = instance.path;
+	}
+	return !path.empty() && write(path);
+}
+
+bool Trace::write(const std::string & path)
+{
+	std::FILE * file = std::fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	auto & instance = registry();
+	const std::lock_guard lock{instance.mutex};
+
+	uint64_t dropped = 0;
+	auto first = true;
+	const auto separate = [&] {
+		std::fputs(first ? "\n" : ",\n", file);
+		first = false;
+	};
+
+	std::fputs("{\"traceEvents\":[", file);
+	for (const auto & buffer: instance.buffers)
+	{
+		if (const auto * name = buffer->name.load(std::memory_order_relaxed))
+		{
+			separate();
+			std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":", buffer->id);
+			writeString(file, name);
+			std::fputs("}}", file);
+		}
+
+		// Events below the published count are complete.
+		const auto count = buffer->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto & event = buffer->events[i];
+			separate();
+			std::fputs("{\"name\":", file);
+			writeString(file, event.name);
+			std::fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}", buffer->id,
+						 static_cast<double>(event.begin) / 1e3, static_cast<double>(event.end - event.begin) / 1e3);
+		}
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	}
+	std::fprintf(file, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%llu}}\n",
+				 static_cast<unsigned long long>(dropped));
+
+	return std::fclose(file) == 0;
+}
+
+void Trace::setThreadName(const char * name)
+{
+	localBuffer().name.store(name, std::memory_order_relaxed);
+}
+
+int64_t Trace::now() noexcept
+{
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::record(const char * name, const int64_t begin, const int64_t end) noexcept
+{
+	auto & buffer = localBuffer();
+	const auto count = buffer.count.load(std::memory_order_relaxed);
+	if (count == g_thread_capacity)
+	{
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	if (!buffer.events)
+	{
+		buffer.events = std::make_unique<Event[]>(g_thread_capacity);
+	}
+
+	buffer.events[count] = {name, begin, end};
+	buffer.count.store(count + 1, std::memory_order_release);
+}
+
+}// namespace fgl
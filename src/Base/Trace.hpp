@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace fgl
+{
+
+// Scoped-zone tracing exported as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+// Every thread appends to its own buffer without locking; a full buffer drops further events.
+// While tracing is off a zone costs one relaxed load and branch.
+class Trace final
+{
+public:
+	[[nodiscard]] static bool enabled() noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+	// Starts recording, flush() then writes to `path`.
+	static void start(std::string path);
+	static void stop() noexcept;
+
+	// Write everything recorded so far, recording goes on.
+	static bool flush();
+	static bool write(const std::string & path);
+
+	// Shown instead of the thread number, must outlive the trace.
+	static void setThreadName(const char * name);
+
+	[[nodiscard]] static int64_t now() noexcept;
+	static void record(const char * name, int64_t begin, int64_t end) noexcept;
+
+private:
+	static inline std::atomic<bool> enabled_{false};
+};
+
+// Zone from construction to destruction. `name` must be a string literal or otherwise outlive the trace.
+class TraceScope final
+{
+public:
+	explicit TraceScope(const char * name) noexcept
+	{
+		if (Trace::enabled())
+		{
+			name_ = name;
+			begin_ = Trace::now();
+		}
+	}
+
+	~TraceScope()
+	{
+		if (name_)
+		{
+			Trace::record(name_, begin_, Trace::now());
+		}
+	}
+
+	TraceScope(const TraceScope &) = delete;
+	TraceScope(TraceScope &&) = delete;
+
+	TraceScope & operator=(const TraceScope &) = delete;
+	TraceScope & operator=(TraceScope &&) = delete;
+
+private:
+	const char * name_ = nullptr;
+	int64_t begin_ = 0;
+};
+
+}// namespace fgl
+
+#define FGL_TRACE_CONCAT_IMPL(lhs, rhs) lhs##rhs
+#define FGL_TRACE_CONCAT(lhs, rhs) FGL_TRACE_CONCAT_IMPL(lhs, rhs)
+#define FGL_TRACE_SCOPE(name) const fgl::TraceScope FGL_TRACE_CONCAT(fglTraceScope, __LINE__){name}
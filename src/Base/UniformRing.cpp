@@ -0,0 +1,166 @@
+#include "UniformRing.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace fgl
+{
+
+namespace
+{
+
+// A second is plenty for one frame of work; giving up beats hanging on a lost context.
+constexpr GLuint64 g_fence_timeout_ns = 1'000'000'000;
+
+}// namespace
+
+UniformRing::UniformRing(const size_t frameCapacity) noexcept
+	: frameCapacity_{frameCapacity}
+{
+}
+
+bool UniformRing::create()
+{
+	destroy();
+	initializeOpenGLFunctions();
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment_ = std::bit_ceil(static_cast<size_t>(std::max(alignment, 1)));
+	return allocate(frameCapacity_);
+}
+
+void UniformRing::destroy()
+{
+	if (mapping_)
+	{
+		flush();
+	}
+	for (auto & fence: fences_)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (buffer_)
+	{
+		glDeleteBuffers(1, &buffer_);
+		buffer_ = 0;
+	}
+	frame_ = 0;
+}
+
+bool UniformRing::allocate(const size_t frameCapacity)
+{
+	// Pending frames keep the old storage alive, the new one is not in use by anything.
+	for (auto & fence: fences_)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (!buffer_)
+	{
+		glGenBuffers(1, &buffer_);
+	}
+
+	const auto capacity = (frameCapacity + alignment_ - 1) / alignment_ * alignment_;
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(capacity * g_frames), nullptr, GL_STREAM_DRAW);
+	// The size of the storage that exists, glGetError() would also report errors raised by anyone before.
+	GLint size = 0;
+	glGetBufferParameteriv(GL_UNIFORM_BUFFER, GL_BUFFER_SIZE, &size);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	frameCapacity_ = static_cast<size_t>(std::max(size, 0)) / g_frames / alignment_ * alignment_;
+	return frameCapacity_ == capacity;
+}
+
+bool UniformRing::beginFrame(const size_t bytes)
+{
+	if (!buffer_)
+	{
+		return false;
+	}
+	if (bytes > frameCapacity_ && !allocate(std::bit_ceil(bytes)))
+	{
+		return false;
+	}
+
+	const auto region = frame_ % g_frames;
+	if (auto & fence = fences_[region])
+	{
+		// Only blocks when the GPU is g_frames frames behind.
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			++stalls_;
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_fence_timeout_ns);
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// The fence guarantees the region is idle, so no implicit synchronization is needed.
+	cursor_ = region * frameCapacity_;
+	end_ = cursor_ + frameCapacity_;
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+	mapping_ = static_cast<std::byte *>(glMapBufferRange(GL_UNIFORM_BUFFER, static_cast<GLintptr>(cursor_),
+														  static_cast<GLsizeiptr>(frameCapacity_),
+														  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	return mapping_ != nullptr;
+}
+
+size_t UniformRing::write(const std::span<const std::byte> block)
+{
+	const auto offset = cursor_;
+	const auto size = alignedSize(block.size());
+	if (!mapping_ || offset + size > end_)
+	{
+		// Out of the reserved space, the block stays unwritten.
+		return offset;
+	}
+
+	std::memcpy(mapping_ + (offset - (end_ - frameCapacity_)), block.data(), block.size());
+	cursor_ += size;
+	return offset;
+}
+
+void UniformRing::flush()
+{
+	if (!mapping_)
+	{
+		return;
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	mapping_ = nullptr;
+}
+
+void UniformRing::bindRange(const GLuint binding, const size_t offset, const size_t size)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer_, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+}
+
+void UniformRing::endFrame()
+{
+	flush();
+	if (!buffer_)
+	{
+		return;
+	}
+	fences_[frame_ % g_frames] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	++frame_;
+}
+
+size_t UniformRing::alignedSize(const size_t size) const noexcept
+{
+	return (size + alignment_ - 1) / alignment_ * alignment_;
+}
+
+}// namespace fgl
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace fgl
+{
+
+// Uniform buffer split into g_frames regions that are written in turn, one per frame.
+// All uniform blocks of a frame are written with a single mapping, then draws select theirs with
+// glBindBufferRange. A region is reused only after the fence of the frame that last read it
+// signalled, so writing never races the GPU.
+class UniformRing final : protected QOpenGLExtraFunctions
+{
+public:
+	static constexpr size_t g_frames = 3;
+
+	explicit UniformRing(size_t frameCapacity = 64u << 10) noexcept;
+
+	UniformRing(const UniformRing &) = delete;
+	UniformRing(UniformRing &&) = delete;
+
+	UniformRing & operator=(const UniformRing &) = delete;
+	UniformRing & operator=(UniformRing &&) = delete;
+
+	// Require a current context.
+	bool create();
+	void destroy();
+	[[nodiscard]] bool created() const noexcept { return buffer_ != 0; }
+
+	// Waits for the oldest region and maps it for at least `bytes`, the ring grows if they do not fit.
+	// Offsets of a frame are aligned, so reserve alignedSize() of every block.
+	bool beginFrame(size_t bytes);
+	// Copies a block into the mapped region and returns its offset in the buffer.
+	[[nodiscard]] size_t write(std::span<const std::byte> block);
+	// Unmaps the region, required before drawing with it.
+	void flush();
+	void bindRange(GLuint binding, size_t offset, size_t size);
+	// Fences the region once the frame's draws are issued.
+	void endFrame();
+
+	[[nodiscard]] size_t alignedSize(size_t size) const noexcept;
+	// Frames that had to wait for the GPU to release their region.
+	[[nodiscard]] uint64_t stalls() const noexcept { return stalls_; }
+
+private:
+	bool allocate(size_t frameCapacity);
+
+private:
+	GLuint buffer_ = 0;
+	size_t frameCapacity_;
+	size_t alignment_ = 256;
+	std::array<GLsync, g_frames> fences_{};
+	size_t frame_ = 0;
+	size_t cursor_ = 0;
+	size_t end_ = 0;
+	std::byte * mapping_ = nullptr;
+	uint64_t stalls_ = 0;
+};
+
+}// namespace fgl
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace fgl
+{
+
+// Bounded Chase-Lev deque (with the memory orders of Lê et al., "Correct and Efficient Work-Stealing for
+// Weak Memory Models"). The owning thread pushes and pops at the bottom, any other thread steals from the
+// top; only the race for the last element takes a compare-and-swap. push() fails when the deque is full.
+template<typename T, size_t Capacity>
+class WorkStealingDeque final
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+	static_assert(std::is_trivially_copyable_v<T>, "slots are atomics");
+
+public:
+	WorkStealingDeque() = default;
+
+	WorkStealingDeque(const WorkStealingDeque &) = delete;
+	WorkStealingDeque(WorkStealingDeque &&) = delete;
+
+	WorkStealingDeque & operator=(const WorkStealingDeque &) = delete;
+	WorkStealingDeque & operator=(WorkStealingDeque &&) = delete;
+
+	// Owner side.
+	bool push(const T & value) noexcept
+	{
+		const auto bottom = bottom_.load(std::memory_order_relaxed);
+		const auto top = top_.load(std::memory_order_acquire);
+		if (bottom - top >= static_cast<int64_t>(Capacity))
+		{
+			return false;
+		}
+		slots_[static_cast<size_t>(bottom) & (Capacity - 1)].store(value, std::memory_order_relaxed);
+		// A release store instead of the paper's fence, same cost and visible to thread sanitizers.
+		bottom_.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Owner side, the most recently pushed element.
+	bool pop(T & value) noexcept
+	{
+		const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+		bottom_.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto top = top_.load(std::memory_order_relaxed);
+		if (top > bottom)
+		{
+			bottom_.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		value = slots_[static_cast<size_t>(bottom) & (Capacity - 1)].load(std::memory_order_relaxed);
+		if (top < bottom)
+		{
+			return true;
+		}
+
+		// The last element, thieves may be after it as well.
+		const auto won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	// Any other thread, the oldest element. Also fails when losing a race for it.
+	bool steal(T & value) noexcept
+	{
+		auto top = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const auto bottom = bottom_.load(std::memory_order_acquire);
+		if (top >= bottom)
+		{
+			return false;
+		}
+
+		value = slots_[static_cast<size_t>(top) & (Capacity - 1)].load(std::memory_order_relaxed);
+		return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+	// Either side, a snapshot.
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+	}
+
+private:
+	// Thieves move the top, the owner the bottom, on separate cache lines so they do not contend.
+	alignas(64) std::atomic<int64_t> top_{0};
+	alignas(64) std::atomic<int64_t> bottom_{0};
+	alignas(64) std::array<std::atomic<T>, Capacity> slots_{};
+};
+
+}// namespace fgl
@@ -0,0 +1,207 @@
+#include <Base/Math.hpp>
+
+#include <QMatrix4x4>
+#include <QVector3D>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t g_default_count = 100000;
+constexpr int g_iterations = 50;
+
+// Median time of one call in milliseconds.
+template <typename Function>
+double measure(const Function & function)
+{
+	std::vector<double> times;
+	times.reserve(g_iterations);
+
+	// Warm up caches and page in the output.
+	function();
+
+	for (int i = 0; i < g_iterations; ++i)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		function();
+		const auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+	}
+
+	std::nth_element(times.begin(), times.begin() + g_iterations / 2, times.end());
+	return times[g_iterations / 2];
+}
+
+// Affine matrices with random rotation-like columns and translation.
+std::vector<fgl::Mat4> randomMatrices(std::mt19937 & rng, const size_t count)
+{
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<fgl::Mat4> matrices(count, fgl::Mat4(1.0f));
+	for (auto & matrix: matrices)
+	{
+		for (int column = 0; column < 4; ++column)
+		{
+			for (int row = 0; row < 3; ++row)
+			{
+				matrix[column][row] = distribution(rng);
+			}
+		}
+	}
+	return matrices;
+}
+
+// Copied through data(), so Qt treats them as general matrices like any it did not build itself.
+std::vector<QMatrix4x4> toQt(const std::vector<fgl::Mat4> & matrices)
+{
+	std::vector<QMatrix4x4> result(matrices.size());
+	for (size_t i = 0; i < matrices.size(); ++i)
+	{
+		const auto elements = fgl::elements(matrices[i]);
+		std::copy(elements.begin(), elements.end(), result[i].data());
+	}
+	return result;
+}
+
+float difference(const QMatrix4x4 & lhs, const fgl::Mat4 & rhs)
+{
+	const auto elements = fgl::elements(rhs);
+	float result = 0.0f;
+	for (size_t i = 0; i < 16; ++i)
+	{
+		result = std::max(result, std::abs(lhs.constData()[i] - elements[i]));
+	}
+	return result;
+}
+
+void report(const char * name, const double qt, const double simd, const float difference)
+{
+	std::printf("%-14s QMatrix4x4 %8.3f ms, glm %8.3f ms, %5.2fx, max difference %g\n", name, qt, simd, qt / simd,
+				static_cast<double>(difference));
+}
+
+void run(const size_t count)
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	const auto parents = randomMatrices(rng, count);
+	const auto locals = randomMatrices(rng, count);
+	const auto qtParents = toQt(parents);
+	const auto qtLocals = toQt(locals);
+
+	std::vector<fgl::Vec3> points(count);
+	for (auto & point: points)
+	{
+		point = fgl::Vec3(distribution(rng), distribution(rng), distribution(rng));
+	}
+
+	std::vector<fgl::Mat4> matrices(count);
+	std::vector<QMatrix4x4> qtMatrices(count);
+	std::vector<fgl::Vec3> transformed(count);
+	std::vector<QVector3D> qtTransformed(count);
+
+	std::printf("%zu matrices, median of %d runs\n", count, g_iterations);
+
+	// World matrices of scene nodes, parent times local.
+	{
+		const auto qt = measure([&] {
+			for (size_t i = 0; i < count; ++i)
+			{
+				qtMatrices[i] = qtParents[i] * qtLocals[i];
+			}
+		});
+		const auto simd = measure([&] {
+			for (size_t i = 0; i < count; ++i)
+			{
+				matrices[i] = parents[i] * locals[i];
+			}
+		});
+		float error = 0.0f;
+		for (size_t i = 0; i < count; ++i)
+		{
+			error = std::max(error, difference(qtMatrices[i], matrices[i]));
+		}
+		report("mat4 * mat4", qt, simd, error);
+	}
+
+	// Bounds corners and sort keys, a point through an affine matrix.
+	{
+		const auto qt = measure([&] {
+			for (size_t i = 0; i < count; ++i)
+			{
+				qtTransformed[i] = qtParents[i].map(QVector3D(points[i].x, points[i].y, points[i].z));
+			}
+		});
+		const auto simd = measure([&] {
+			for (size_t i = 0; i < count; ++i)
+			{
+				transformed[i] = fgl::transformPoint(parents[i], points[i]);
+			}
+		});
+		float error = 0.0f;
+		for (size_t i = 0; i < count; ++i)
+		{
+			error = std::max({error, std::abs(qtTransformed[i].x() - transformed[i].x),
+							  std::abs(qtTransformed[i].y() - transformed[i].y), std::abs(qtTransformed[i].z() - transformed[i].z)});
+		}
+		report("mat4 * point", qt, simd, error);
+	}
+
+	// What the renderer does every frame: a camera looking at the scene and the view-projection product.
+	{
+		const auto eye = [&](const size_t i) {
+			const auto angle = static_cast<float>(i) * 1e-3f;
+			return fgl::Vec3(std::sin(angle) * 3.0f, 1.0f, std::cos(angle) * 3.0f);
+		};
+
+		QMatrix4x4 qtProjection;
+		qtProjection.perspective(60.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+		const auto qt = measure([&] {
+			for (size_t i = 0; i < count; ++i)
+			{
+				const auto position = eye(i);
+				QMatrix4x4 view;
+				view.lookAt(QVector3D(position.x, position.y, position.z), QVector3D(0.0f, 0.0f, 0.0f),
+							QVector3D(0.0f, 1.0f, 0.0f));
+				qtMatrices[i] = qtProjection * view;
+			}
+		});
+
+		const auto projection = fgl::perspective(60.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+		const auto simd = measure([&] {
+			for (size_t i = 0; i < count; ++i)
+			{
+				const auto view = fgl::lookAt(eye(i), fgl::Vec3(0.0f), fgl::Vec3(0.0f, 1.0f, 0.0f));
+				matrices[i] = projection * view;
+			}
+		});
+		float error = 0.0f;
+		for (size_t i = 0; i < count; ++i)
+		{
+			error = std::max(error, difference(qtMatrices[i], matrices[i]));
+		}
+		report("camera", qt, simd, error);
+	}
+}
+
+}// namespace
+
+int main(int argc, char ** argv)
+{
+	const auto count = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : g_default_count;
+	if (count == 0)
+	{
+		std::fprintf(stderr, "Usage: math-bench [matrices]\n");
+		return 1;
+	}
+
+	run(count);
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include <Base/MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t g_default_grid = 512;
+constexpr size_t g_stride = 3;
+
+struct Mesh {
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+};
+
+// Closed cylinder-like surface out of a grid, so clusters face in different directions.
+Mesh grid(const size_t size)
+{
+	Mesh mesh;
+	const auto pi = std::acos(-1.0f);
+	for (size_t y = 0; y < size; ++y)
+	{
+		for (size_t x = 0; x < size; ++x)
+		{
+			const auto angle = 2.0f * pi * static_cast<float>(x) / static_cast<float>(size);
+			mesh.positions.insert(mesh.positions.end(), {std::cos(angle), static_cast<float>(y) / static_cast<float>(size), std::sin(angle)});
+		}
+	}
+
+	for (size_t y = 0; y + 1 < size; ++y)
+	{
+		for (size_t x = 0; x + 1 < size; ++x)
+		{
+			const auto i = static_cast<uint32_t>(y * size + x);
+			const auto row = static_cast<uint32_t>(size);
+			mesh.indices.insert(mesh.indices.end(), {i, i + row, i + 1, i + 1, i + row, i + row + 1});
+		}
+	}
+	return mesh;
+}
+
+// Triangles and vertices in random order, the worst an exporter can do.
+void shuffle(Mesh & mesh, std::mt19937 & rng)
+{
+	const auto triangles = mesh.indices.size() / 3;
+	std::vector<size_t> order(triangles);
+	std::iota(order.begin(), order.end(), size_t{0});
+	std::shuffle(order.begin(), order.end(), rng);
+
+	std::vector<uint32_t> indices;
+	indices.reserve(mesh.indices.size());
+	for (const auto triangle: order)
+	{
+		indices.insert(indices.end(), mesh.indices.begin() + static_cast<std::ptrdiff_t>(triangle * 3),
+					   mesh.indices.begin() + static_cast<std::ptrdiff_t>(triangle * 3 + 3));
+	}
+
+	const auto vertices = mesh.positions.size() / g_stride;
+	std::vector<uint32_t> remap(vertices);
+	std::iota(remap.begin(), remap.end(), 0u);
+	std::shuffle(remap.begin(), remap.end(), rng);
+	for (auto & index: indices)
+	{
+		index = remap[index];
+	}
+
+	std::vector<float> positions(mesh.positions.size());
+	for (size_t vertex = 0; vertex < vertices; ++vertex)
+	{
+		std::copy_n(mesh.positions.data() + vertex * g_stride, g_stride, positions.data() + remap[vertex] * g_stride);
+	}
+	mesh.indices = std::move(indices);
+	mesh.positions = std::move(positions);
+}
+
+void run(const char * label, Mesh mesh)
+{
+	const fgl::MeshOptimizer optimizer;
+	const auto vertices = mesh.positions.size() / g_stride;
+	const auto before = optimizer.analyze(mesh.indices, vertices);
+
+	const auto begin = std::chrono::steady_clock::now();
+	optimizer.reorderTriangles(mesh.indices, mesh.positions, g_stride);
+	const auto remap = fgl::MeshOptimizer::reorderVertices(mesh.indices, vertices);
+	fgl::MeshOptimizer::remapVertices(mesh.positions, g_stride, remap);
+	const auto end = std::chrono::steady_clock::now();
+
+	const auto after = optimizer.analyze(mesh.indices, mesh.positions.size() / g_stride);
+	std::printf("%-10s ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  %8.2f ms\n", label,
+				static_cast<double>(before.acmr()), static_cast<double>(after.acmr()),
+				static_cast<double>(before.atvr()), static_cast<double>(after.atvr()),
+				std::chrono::duration<double, std::milli>(end - begin).count());
+}
+
+}// namespace
+
+int main(int argc, char ** argv)
+{
+	const auto size = argc > 1 ? std::max<size_t>(std::strtoull(argv[1], nullptr, 10), 2) : g_default_grid;
+
+	auto mesh = grid(size);
+	std::printf("%zu vertices, %zu triangles, FIFO cache of %zu\n", mesh.positions.size() / g_stride,
+				mesh.indices.size() / 3, fgl::MeshOptimizer::g_cache_size);
+
+	run("row order", mesh);
+
+	std::mt19937 rng(42);
+	shuffle(mesh, rng);
+	run("shuffled", std::move(mesh));
+	return 0;
+}
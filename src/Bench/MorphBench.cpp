@@ -0,0 +1,153 @@
+#include <Base/MorphBlender.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t g_default_vertices = 1'000'000;
+constexpr size_t g_default_targets = 8;
+constexpr int g_iterations = 50;
+// Fraction of vertices a blendshape moves in the sparse run.
+constexpr double g_sparse_fraction = 0.05;
+
+template <typename T>
+std::vector<T> randomStream(std::mt19937 & rng, const size_t size, const float range)
+{
+	std::uniform_real_distribution<float> distribution(-range, range);
+	std::vector<T> values(size);
+	for (auto & value: values)
+	{
+		value = static_cast<T>(distribution(rng));
+	}
+	return values;
+}
+
+// Median time of one call in milliseconds.
+template <typename Function>
+double measure(const Function & function)
+{
+	std::vector<double> times;
+	times.reserve(g_iterations);
+
+	// Warm up caches and page in the output.
+	function();
+
+	for (int i = 0; i < g_iterations; ++i)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		function();
+		const auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+	}
+
+	std::nth_element(times.begin(), times.begin() + g_iterations / 2, times.end());
+	return times[g_iterations / 2];
+}
+
+template <typename T>
+void run(const char * label, const fgl::ComponentType type, const bool normalized, const float range,
+		 const size_t vertices, const size_t targetCount)
+{
+	std::mt19937 rng(42);
+
+	const auto base = randomStream<float>(rng, vertices * 3, 1.0f);
+	std::vector<std::vector<T>> deltas;
+	std::vector<fgl::AttributeStream> targets;
+	std::vector<float> weights;
+	for (size_t i = 0; i < targetCount; ++i)
+	{
+		deltas.push_back(randomStream<T>(rng, vertices * 3, range));
+		targets.push_back({reinterpret_cast<const std::byte *>(deltas.back().data()), vertices, 3 * sizeof(T), 3, type, normalized});
+		weights.push_back(1.0f / static_cast<float>(i + 1));
+	}
+
+	const fgl::AttributeStream baseStream{reinterpret_cast<const std::byte *>(base.data()), vertices, 3 * sizeof(float), 3};
+	std::vector<float> out(vertices * 3);
+
+	for (const auto kernel: {fgl::MorphBlender::Kernel::Scalar, fgl::MorphBlender::Kernel::Sse2, fgl::MorphBlender::Kernel::Avx2})
+	{
+		if (!fgl::MorphBlender::supported(kernel))
+		{
+			continue;
+		}
+
+		const fgl::MorphBlender blender{kernel};
+		const auto ms = measure([&] { blender.blend(baseStream, targets, weights, out); });
+		const auto bytes = static_cast<double>(vertices * 3 * (sizeof(float) * 2 + sizeof(T) * targetCount));
+		std::printf("%-8s %-7s %8.3f ms %8.2f GB/s\n", label, fgl::MorphBlender::name(kernel), ms, bytes / ms / 1e6);
+	}
+}
+
+// Blendshapes that each move a small contiguous region, blended dense and as compacted sparse targets.
+void runSparse(const size_t vertices, const size_t targetCount)
+{
+	std::mt19937 rng(42);
+
+	const auto touched = std::max<size_t>(1, static_cast<size_t>(static_cast<double>(vertices) * g_sparse_fraction));
+	std::uniform_int_distribution<size_t> regions(0, vertices - touched);
+
+	const auto base = randomStream<float>(rng, vertices * 3, 1.0f);
+	std::vector<std::vector<float>> deltas;
+	std::vector<fgl::AttributeStream> targets;
+	std::vector<float> weights;
+	for (size_t i = 0; i < targetCount; ++i)
+	{
+		deltas.emplace_back(vertices * 3, 0.0f);
+		const auto region = randomStream<float>(rng, touched * 3, 1.0f);
+		std::copy(region.begin(), region.end(), deltas.back().begin() + static_cast<std::ptrdiff_t>(regions(rng) * 3));
+		targets.push_back({reinterpret_cast<const std::byte *>(deltas.back().data()), vertices, 3 * sizeof(float), 3});
+		weights.push_back(1.0f / static_cast<float>(i + 1));
+	}
+
+	const fgl::AttributeStream baseStream{reinterpret_cast<const std::byte *>(base.data()), vertices, 3 * sizeof(float), 3};
+	std::vector<float> out(vertices * 3);
+
+	for (const auto kernel: {fgl::MorphBlender::Kernel::Scalar, fgl::MorphBlender::Kernel::Sse2, fgl::MorphBlender::Kernel::Avx2})
+	{
+		if (!fgl::MorphBlender::supported(kernel))
+		{
+			continue;
+		}
+
+		const fgl::MorphBlender blender{kernel};
+		std::vector<fgl::SparseTarget> sparse;
+		size_t sparseBytes = 0;
+		for (const auto & target: targets)
+		{
+			sparse.push_back(blender.compact(target, vertices).value_or(fgl::SparseTarget{}));
+			sparseBytes += sparse.back().indices.size() * sizeof(uint32_t) + sparse.back().deltas.size() * sizeof(float);
+		}
+
+		const auto dense = measure([&] { blender.blend(baseStream, targets, weights, out); });
+		const auto scattered = measure([&] {
+			blender.blend(baseStream, {}, {}, out);
+			blender.scatter(sparse, weights, 3, out);
+		});
+		std::printf("sparse   %-7s %8.3f ms dense %8.3f ms scatter, targets %6.1f MB dense %6.1f MB sparse\n",
+					fgl::MorphBlender::name(kernel), dense, scattered,
+					static_cast<double>(vertices * 3 * sizeof(float) * targetCount) / 1e6, static_cast<double>(sparseBytes) / 1e6);
+	}
+}
+
+}// namespace
+
+int main(int argc, char ** argv)
+{
+	const auto vertices = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : g_default_vertices;
+	const auto targets = argc > 2 ? static_cast<size_t>(std::strtoull(argv[2], nullptr, 10)) : g_default_targets;
+
+	std::printf("Blending %zu vertices with %zu targets, median of %d runs\n", vertices, targets, g_iterations);
+	run<float>("float", fgl::ComponentType::Float, false, 1.0f, vertices, targets);
+	run<int16_t>("snorm16", fgl::ComponentType::Short, true, 32767.0f, vertices, targets);
+	run<int8_t>("snorm8", fgl::ComponentType::Byte, true, 127.0f, vertices, targets);
+	runSparse(vertices, targets);
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+#include <Base/Skinning.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t g_default_characters = 128;
+constexpr size_t g_default_joints = 64;
+constexpr size_t g_default_vertices = 8000;
+constexpr int g_iterations = 50;
+
+// Median time of one call in milliseconds.
+template <typename Function>
+double measure(const Function & function)
+{
+	std::vector<double> times;
+	times.reserve(g_iterations);
+
+	// Warm up caches and page in the output.
+	function();
+
+	for (int i = 0; i < g_iterations; ++i)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		function();
+		const auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+	}
+
+	std::nth_element(times.begin(), times.begin() + g_iterations / 2, times.end());
+	return times[g_iterations / 2];
+}
+
+// Column-major affine matrices with random rotation-like columns and translation.
+std::vector<float> randomMatrices(std::mt19937 & rng, const size_t count)
+{
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<float> matrices(count * 16, 0.0f);
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto * matrix = matrices.data() + i * 16;
+		for (size_t column = 0; column < 4; ++column)
+		{
+			for (size_t row = 0; row < 3; ++row)
+			{
+				matrix[column * 4 + row] = distribution(rng);
+			}
+		}
+		matrix[15] = 1.0f;
+	}
+	return matrices;
+}
+
+struct Character {
+	size_t skin = 0;
+	std::vector<float> worlds;
+};
+
+void run(const size_t characterCount, const size_t joints, const size_t vertices)
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::uniform_int_distribution<uint16_t> jointDistribution(0, static_cast<uint16_t>(joints - 1));
+
+	// One mesh shared by every character, each with its own skeleton.
+	std::vector<float> positions(vertices * 3);
+	std::vector<uint16_t> vertexJoints(vertices * fgl::Skinning::g_influences);
+	std::vector<float> weights(vertices * fgl::Skinning::g_influences);
+	for (auto & position: positions)
+	{
+		position = distribution(rng);
+	}
+	for (size_t vertex = 0; vertex < vertices; ++vertex)
+	{
+		float sum = 0.0f;
+		for (size_t i = 0; i < fgl::Skinning::g_influences; ++i)
+		{
+			vertexJoints[vertex * fgl::Skinning::g_influences + i] = jointDistribution(rng);
+			weights[vertex * fgl::Skinning::g_influences + i] = std::abs(distribution(rng));
+			sum += weights[vertex * fgl::Skinning::g_influences + i];
+		}
+		for (size_t i = 0; i < fgl::Skinning::g_influences; ++i)
+		{
+			weights[vertex * fgl::Skinning::g_influences + i] /= sum;
+		}
+	}
+
+	const auto inverseBinds = randomMatrices(rng, joints);
+	std::vector<float> palettes(characterCount * joints * fgl::Skinning::g_matrix_size);
+	std::vector<float> skinned(characterCount * vertices * 3);
+
+	const auto paletteBytes = static_cast<double>(palettes.size() * sizeof(float));
+	const auto vertexBytes = static_cast<double>(skinned.size() * sizeof(float));
+	std::printf("%zu characters, %zu joints, %zu vertices each, median of %d runs\n", characterCount, joints, vertices,
+				g_iterations);
+	std::printf("uploads per frame: gpu %.2f MB of joint matrices, cpu %.2f MB of positions\n", paletteBytes / 1e6,
+				vertexBytes / 1e6);
+
+	for (const auto kernel: {fgl::Skinning::Kernel::Scalar, fgl::Skinning::Kernel::Sse2, fgl::Skinning::Kernel::Avx2})
+	{
+		if (!fgl::MorphBlender::supported(kernel))
+		{
+			continue;
+		}
+
+		fgl::Skinning skinning{kernel};
+		std::vector<Character> characters(characterCount);
+		for (auto & character: characters)
+		{
+			character.skin = skinning.add(inverseBinds);
+			character.worlds = randomMatrices(rng, joints);
+		}
+
+		const auto palette = [&](const size_t i) {
+			return std::span(palettes).subspan(i * joints * fgl::Skinning::g_matrix_size, joints * fgl::Skinning::g_matrix_size);
+		};
+		const auto updatePalettes = [&] {
+			for (size_t i = 0; i < characters.size(); ++i)
+			{
+				skinning.palette(characters[i].skin, characters[i].worlds, palette(i));
+			}
+		};
+
+		// The GPU path stops here, the vertex shader does the rest.
+		const auto gpu = measure(updatePalettes);
+		const auto cpu = measure([&] {
+			updatePalettes();
+			for (size_t i = 0; i < characters.size(); ++i)
+			{
+				skinning.skin(positions, vertexJoints, weights, palette(i), std::span(skinned).subspan(i * vertices * 3, vertices * 3));
+			}
+		});
+		std::printf("%-7s palettes %8.3f ms, cpu skinning %8.3f ms %8.1f Mvertices/s\n", fgl::MorphBlender::name(kernel),
+					gpu, cpu, static_cast<double>(characterCount * vertices) / (cpu - gpu) / 1e3);
+	}
+}
+
+}// namespace
+
+int main(int argc, char ** argv)
+{
+	const auto characters = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : g_default_characters;
+	const auto joints = argc > 2 ? static_cast<size_t>(std::strtoull(argv[2], nullptr, 10)) : g_default_joints;
+	const auto vertices = argc > 3 ? static_cast<size_t>(std::strtoull(argv[3], nullptr, 10)) : g_default_vertices;
+	if (characters == 0 || joints == 0 || joints > UINT16_MAX || vertices == 0)
+	{
+		std::fprintf(stderr, "Usage: skin-bench [characters] [joints] [vertices]\n");
+		return 1;
+	}
+
+	run(characters, joints, vertices);
+	return 0;
+}